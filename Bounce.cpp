@@ -5,6 +5,7 @@
 ` --------------------------------- . --------------------------------------- */
 #include "Tools.h"
 #include <Docgl/DocglWindow.h>
+#include <chrono> // for update benchmark
 
 ////////////////////////  OpenGL Context caching test //////////////////////////
 
@@ -30,6 +31,13 @@ public:
   virtual docgl::GLRegister<GLint>& getPixelStoreRowByteAligment(bool packing)
     { if (packing) return cachedPixelStorePackRowByteAligment; else return cachedPixelStoreUnPackRowByteAligment;}
 
+  virtual docgl::GLErrorFlags flushPendingValues()
+  {
+    docgl::GLErrorFlags errorFlags = cachedPixelStorePackRowByteAligment.flushPendingValue();
+    errorFlags.merge(cachedPixelStoreUnPackRowByteAligment.flushPendingValue());
+    return errorFlags;
+  }
+
   docgl::GLCachedRegister<GLint> cachedPixelStorePackRowByteAligment;
   docgl::GLCachedRegister<GLint> cachedPixelStoreUnPackRowByteAligment;
 };
@@ -39,7 +47,7 @@ public:
 struct Globals : public OpenGLWindowCallback
 {
   ClientWithTooMuchRowByteAligmentChangeContext context;
-  docgl::GLBufferObject squareVertexBuffer;
+  docgl::GLDynamicBufferObject squareVertexBuffer;
   docgl::GLBufferObject squareTexCoordBuffer;
   docgl::GLVertexArrayObject squareVertexArray;
   docgl::GLTextureObject squareTexture;
@@ -53,6 +61,13 @@ struct Globals : public OpenGLWindowCallback
   GLfloat texCoord[8];
   bool wantExit;
 
+  // update benchmark: keys 1, 2, 3 select the vertex buffer update frequency strategy
+  docgl::GLUpdateFrequency vertexUpdateFrequency;
+  std::chrono::high_resolution_clock::time_point lastFrameTime;
+  double updateMicroseconds;
+  double frameMicroseconds;
+  size_t numBenchmarkFrames;
+
   Globals()
     : squareVertexBuffer(context)
     , squareTexCoordBuffer(context)
@@ -64,6 +79,10 @@ struct Globals : public OpenGLWindowCallback
     , sceneSetupComplete(false)
     , blockSize(0.1f)
     , wantExit(false)
+    , vertexUpdateFrequency(docgl::perFrameUpdates)
+    , updateMicroseconds(0.0)
+    , frameMicroseconds(0.0)
+    , numBenchmarkFrames(0)
 
   {
 
@@ -93,13 +112,11 @@ void SetupRC()
   jassert(succeed);
 
   // Load up triangles and mapping coordinate with VBO
-  succeed = squareVertexBuffer.create(sizeof(GLfloat) * 3 * 4, vVerts, GL_DYNAMIC_DRAW).hasSucceed();
-  jassert(succeed);
   succeed = squareTexCoordBuffer.create(sizeof(GLfloat) * 2 * 4, texCoord, GL_DYNAMIC_DRAW).hasSucceed();
   jassert(succeed);
   succeed = squareVertexArray.create().hasSucceed();
   jassert(succeed);
-  succeed = squareVertexArray.linkAttributeToBuffer(0, 3, GL_FLOAT, GL_FALSE, squareVertexBuffer.getId()).hasSucceed();
+  succeed = createSquareVertexBuffer(vertexUpdateFrequency).hasSucceed();
   jassert(succeed);
   succeed = squareVertexArray.linkAttributeToBuffer(1, 2, GL_FLOAT, GL_FALSE, squareTexCoordBuffer.getId()).hasSucceed();
   jassert(succeed);
@@ -171,6 +188,41 @@ void SetupRC()
   sceneSetupComplete = true;
 }
 
+// (re)create the moving square vertex buffer with an update strategy
+docgl::GLErrorFlags createSquareVertexBuffer(docgl::GLUpdateFrequency frequency)
+{
+  static const char* const frequencyNames[] = {"rareUpdates", "perFrameUpdates", "perDrawUpdates"};
+  if (squareVertexBuffer.getId())
+    squareVertexBuffer.destroy();
+  vertexUpdateFrequency = frequency;
+  numBenchmarkFrames = 0;
+  updateMicroseconds = frameMicroseconds = 0.0;
+  printf("Vertex buffer update strategy: %s\n", frequencyNames[frequency]);
+
+  const docgl::GLErrorFlags errorFlags = squareVertexBuffer.create(sizeof(GLfloat) * 3 * 4, vVerts, frequency);
+  if (errorFlags.hasErrors())
+    return errorFlags;
+  return squareVertexBuffer.linkAttribute(squareVertexArray, 0, 3, GL_FLOAT, GL_FALSE);
+}
+
+// average update and frame durations, printed every 256 frames
+void benchmarkFrame(double updateDuration)
+{
+  const std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+  if (numBenchmarkFrames++)
+  {
+    updateMicroseconds += updateDuration;
+    frameMicroseconds += std::chrono::duration<double, std::micro>(now - lastFrameTime).count();
+  }
+  lastFrameTime = now;
+  if (numBenchmarkFrames == 257)
+  {
+    printf("update: %.2f us, frame: %.2f us\n", updateMicroseconds / 256.0, frameMicroseconds / 256.0);
+    numBenchmarkFrames = 1;
+    updateMicroseconds = frameMicroseconds = 0.0;
+  }
+}
+
 // Respond to arrow keys by moving the camera frame of reference
 void BounceFunction()
 {
@@ -204,8 +256,10 @@ void BounceFunction()
   vVerts[9] = blockX;
   vVerts[10] = blockY;
 
-  const bool succeed = squareVertexBuffer.set(sizeof(GLfloat) * 3 * 4, vVerts).hasSucceed();
+  const std::chrono::high_resolution_clock::time_point updateStart = std::chrono::high_resolution_clock::now();
+  const bool succeed = squareVertexBuffer.update(vVerts).hasSucceed();
   jassert(succeed);
+  benchmarkFrame(std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - updateStart).count());
 }
 
 virtual void draw()
@@ -284,6 +338,11 @@ virtual void resized(int w, int h)
     bool invalidateMesh = false;
     if (key == 0x1B) // Escape
       wantExit = true;
+    else if (key >= '1' && key <= '3' && sceneSetupComplete)
+    {
+      const bool succeed = createSquareVertexBuffer((docgl::GLUpdateFrequency)(key - '1')).hasSucceed();
+      jassert(succeed);
+    }
   }
 
   virtual void closed()
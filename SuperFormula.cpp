@@ -328,7 +328,7 @@ public:
 
 int superFormula(const char* szClassName, int x, int y, int width, int height)
 {
-  docgl::GLDirectContext context;
+  docgl::GLCachedContext context;
   SuperFormula superFormula(context);
   OpenGLWindow window(context);
 
@@ -346,6 +346,7 @@ int superFormula(const char* szClassName, int x, int y, int width, int height)
     fprintf(stderr, "GLContext initialize error\n");
     return 2;
   }
+  context.setDeferredMode(true); // polygon offset toggles reach OpenGL only at draw time
 
 #ifdef DOCGL4_1
   printf("max subroutines per shader stage: %u\n", superFormula.context.getMaxSubRoutines());
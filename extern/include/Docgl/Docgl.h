@@ -25,12 +25,14 @@
 | - Objects methods ensure to restore Contexts Registers values before leave.  |
 | - Objects can use GLScopedSetValue to restore Contexts Registers values.     |
 | - GLScopedSetValue produce perforance penalty on non cached Registers.       |
+| - GLCachedContext defers restores until the next draw or clear.              |
 |                                                                              |
 | Error strategy:                                                              |
 | - All methods assert on bad in/out values and return GLErrorFlags.           |
 | - createXXX and getXXX return OpenGL error with potential perforance penalty.|
 | - setXXX and linkXXX return flags WITHOUT OpenGL call perforance penalty.    |
 | - jassertglsucceed must follow OpenGL calls without popContextErrorFlags.    |
+| - DOCGL_ERROR_POLICY choose which error checks really call glGetError.       |
 ` --------------------------------------------------------------------------- */
 
 #ifndef DOCGL_H_
@@ -80,7 +82,54 @@
 #  define jassertfalse
 # endif // !DEBUG
 
-# include <map> // for GLIntegerConstantsStore
+# include <vector> // for GLCachedTextureUnitRegister
+# include <string> // for GLProgramReflection
+# include <algorithm> // for GLProgramReflection
+# include <cstdio> // for GLCachedContext audit
+# include <atomic> // for GLDebugMessageRing and GLErrorSite
+# include <cstdlib> // for GLErrorSite atexit
+# include <set> // for GLBufferHeap
+
+// VS2012/VS2013 have no snprintf: _snprintf does not terminate truncated texts (size must be positive).
+# if defined(_MSC_VER) && _MSC_VER < 1900
+#  define DOCGL_SNPRINTF(text, size, ...) ((void)_snprintf(text, size, __VA_ARGS__), (text)[(size) - 1] = '\0')
+# else
+#  define DOCGL_SNPRINTF snprintf
+# endif // !_MSC_VER
+
+// registers statistics: define DOCGL_INSTRUMENTATION to count and time cached registers OpenGL accesses.
+# ifdef DOCGL_INSTRUMENTATION
+#  include <chrono>
+#  define DOCGL_INSTRUMENT(X) X
+# else
+#  define DOCGL_INSTRUMENT(X)
+# endif // !DOCGL_INSTRUMENTATION
+
+// errors polling: define DOCGL_ERROR_POLICY to choose which clearErrorFlags/popErrorFlags calls reach glGetError (see GLErrorPolicy).
+# define DOCGL_ERROR_POLICY_NEVER                 0
+# define DOCGL_ERROR_POLICY_ON_RESOURCE_CREATION  1
+# define DOCGL_ERROR_POLICY_SAMPLED               2 // one state check every DOCGL_ERROR_SAMPLING_PERIOD
+# define DOCGL_ERROR_POLICY_ALWAYS                3
+# ifndef DOCGL_ERROR_POLICY
+#  define DOCGL_ERROR_POLICY DOCGL_ERROR_POLICY_ALWAYS
+# endif // !DOCGL_ERROR_POLICY
+# ifndef DOCGL_ERROR_SAMPLING_PERIOD
+#  define DOCGL_ERROR_SAMPLING_PERIOD 64
+# endif // !DOCGL_ERROR_SAMPLING_PERIOD
+
+// errors histogram: define DOCGL_ERROR_HISTOGRAM to count OpenGL errors per docgl call site (see GLErrorSite).
+// DOCGL_ERROR_SITE is a static GLErrorSite per call site (registered at first use), or NULL.
+// DOCGL_POP_ERROR_FLAGS / DOCGL_CLEAR_ERROR_FLAGS pass their call site to the context (plain popErrorFlags have none).
+# define DOCGL_POP_ERROR_FLAGS(context, check) (context).popErrorFlagsAt(DOCGL_ERROR_SITE, check)
+# define DOCGL_CLEAR_ERROR_FLAGS(context, check) (context).clearErrorFlagsAt(DOCGL_ERROR_SITE, check)
+# ifdef DOCGL_ERROR_HISTOGRAM
+#  define DOCGL_ERROR_SITE ([](const char* function) -> docgl::GLErrorSite* \
+    {static docgl::GLErrorSite site(__FILE__, __LINE__, function); return &site;}(__FUNCTION__))
+#  define DOCGL_ERROR_HISTOGRAM_ONLY(...) __VA_ARGS__
+# else
+#  define DOCGL_ERROR_SITE NULL
+#  define DOCGL_ERROR_HISTOGRAM_ONLY(...)
+# endif // !DOCGL_ERROR_HISTOGRAM
 
 namespace docgl
 {
@@ -92,11 +141,12 @@ class GLErrorFlags
 public:
   // construction
   GLErrorFlags()
-    : errorFlags(0), unknownErrorCode(GL_NO_ERROR) {}
+    : errorFlags(0), unknownErrorCode(GL_NO_ERROR) DOCGL_ERROR_HISTOGRAM_ONLY(, siteId(0)) {}
   GLErrorFlags(const GLErrorFlags& other)
   {
     errorFlags = other.errorFlags;
     unknownErrorCode = other.unknownErrorCode;
+    DOCGL_ERROR_HISTOGRAM_ONLY(siteId = other.siteId;)
   }
   // custom error generation constructor
   enum ErrorFlags
@@ -111,11 +161,13 @@ public:
   {
     unknownErrorCode = 0;
     this->errorFlags = errorFlags;
+    DOCGL_ERROR_HISTOGRAM_ONLY(siteId = 0;)
   }
 
   void merge(const GLErrorFlags& otherErrorFlags)
   {
     errorFlags |= otherErrorFlags.errorFlags;
+    DOCGL_ERROR_HISTOGRAM_ONLY(if (!siteId) siteId = otherErrorFlags.siteId;) // first failing site
     if (otherErrorFlags.unknownErrorCode != GL_NO_ERROR)
     {
       jassert(unknownErrorCode == GL_NO_ERROR); // Impossible merge on unknownErrorCode: loosing previous value
@@ -152,9 +204,20 @@ public:
   void setUnknownErrorCode(GLenum unknownErrorCode)
     {this->unknownErrorCode = unknownErrorCode;}
 
+# ifdef DOCGL_ERROR_HISTOGRAM
+  // call site which polled the errors (GLErrorSite::find), 0 for docgl validation errors.
+  GLuint getSiteId() const
+    {return siteId;}
+  void setSiteId(GLuint siteId)
+    {this->siteId = siteId;}
+# endif // DOCGL_ERROR_HISTOGRAM
+
 private:
   int errorFlags;
   GLenum unknownErrorCode;
+# ifdef DOCGL_ERROR_HISTOGRAM
+  GLuint siteId;
+# endif // DOCGL_ERROR_HISTOGRAM
 };
 
 // NB: default constructor set flags to succeed
@@ -162,6 +225,116 @@ const GLErrorFlags GLErrorFlags::succeed;
 
 //////////////////////////////////////////////////////////////////////////////
 
+// OpenGL errors polling call site (DOCGL_ERROR_SITE): per site errors histogram, linked in a global list at first use.
+// Counters are atomic (contexts on several threads), dumps and resets are not synchronized with them.
+struct GLErrorSite
+{
+  enum {invalidEnumId, invalidValueId, invalidOperationId, outOfVideoMemoryId, invalidFrameBufferOperationId, unknownErrorCodeId,
+        numErrorIds};
+
+  GLErrorSite(const char* file, int line, const char* function)
+    : file(file), line(line), function(function)
+  {
+    reset();
+    next = getFirst().load();
+    while (!getFirst().compare_exchange_weak(next, this)) {}
+    id = (next ? next->id : 0) + 1;
+  }
+
+  // count polled errors and tag them with this site id
+  void record(GLErrorFlags& errorFlags)
+  {
+    numPolls.fetch_add(1, std::memory_order_relaxed);
+    if (errorFlags.hasSucceed())
+      return;
+    const bool hasErrors[numErrorIds] = {errorFlags.hasInvalidEnum(), errorFlags.hasInvalidValue(), errorFlags.hasInvalidOperation(),
+      errorFlags.hasOutOfMemory(), errorFlags.hasInvalidFrameBufferOperation(), errorFlags.hasUnkownErrorCode()};
+    for (size_t i = 0; i < numErrorIds; ++i)
+      if (hasErrors[i])
+        numErrors[i].fetch_add(1, std::memory_order_relaxed);
+    DOCGL_ERROR_HISTOGRAM_ONLY(errorFlags.setSiteId(id);)
+  }
+
+  // clearErrorFlags found errors left by earlier unchecked calls
+  void recordDiscarded()
+    {numDiscarded.fetch_add(1, std::memory_order_relaxed);}
+
+  void reset()
+  {
+    numPolls.store(0);
+    numDiscarded.store(0);
+    for (size_t i = 0; i < numErrorIds; ++i)
+      numErrors[i].store(0);
+  }
+
+  size_t getNumErrors() const
+  {
+    size_t result = 0;
+    for (size_t i = 0; i < numErrorIds; ++i)
+      result += numErrors[i];
+    return result;
+  }
+
+  // registered sites
+  static GLErrorSite* getFirstSite()
+    {return getFirst().load();}
+  GLErrorSite* getNextSite() const
+    {return next;}
+  static const GLErrorSite* find(GLuint id)
+  {
+    for (const GLErrorSite* site = getFirstSite(); site; site = site->next)
+      if (site->id == id)
+        return site;
+    return NULL;
+  }
+
+  // one line per polled site: site,file,line,function,polls,invalidEnum,invalidValue,invalidOperation,outOfMemory,invalidFrameBufferOperation,unknown,discarded
+  // errorsOnly: skip sites without error (discarded ones included).
+  static void dumpHistogramAsCSV(FILE* file, bool withHeader, bool errorsOnly = true)
+  {
+    if (withHeader)
+      fprintf(file, "site,file,line,function,polls,invalidEnum,invalidValue,invalidOperation,outOfMemory,invalidFrameBufferOperation,unknown,discarded\n");
+    for (const GLErrorSite* site = getFirstSite(); site; site = site->next)
+    {
+      const size_t numDiscarded = site->numDiscarded.load();
+      if ((!site->numPolls.load() && !numDiscarded) || (errorsOnly && !site->getNumErrors() && !numDiscarded))
+        continue;
+      fprintf(file, "%u,%s,%d,%s,%lu", site->id, site->file, site->line, site->function, (unsigned long)site->numPolls.load());
+      for (size_t i = 0; i < numErrorIds; ++i)
+        fprintf(file, ",%lu", (unsigned long)site->numErrors[i].load());
+      fprintf(file, ",%lu\n", (unsigned long)numDiscarded);
+    }
+  }
+
+  static void resetHistogram()
+  {
+    for (GLErrorSite* site = getFirstSite(); site; site = site->next)
+      site->reset();
+  }
+
+  // dump sites with errors on stderr at process exit
+  static void dumpHistogramAtExit()
+    {atexit(&dumpHistogramOnStandardError);}
+
+  GLuint id; // 1 based, registration order
+  const char* file;
+  int line;
+  const char* function;
+  std::atomic<size_t> numPolls;      // popErrorFlags polls
+  std::atomic<size_t> numErrors[numErrorIds];
+  std::atomic<size_t> numDiscarded;  // clearErrorFlags polls with errors (earlier calls errors)
+
+private:
+  static std::atomic<GLErrorSite*>& getFirst()
+    {static std::atomic<GLErrorSite*> first(NULL); return first;}
+  static void dumpHistogramOnStandardError()
+    {dumpHistogramAsCSV(stderr, true);}
+
+  GLErrorSite* next;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
 struct GLColor
 {
   enum {
@@ -350,24 +523,112 @@ struct GLPolygonOffset
   GLPolygonOffset(GLfloat factor = 0.0f, GLfloat units = 0.0f)
     : factor(factor), units(units) {}
 
+  bool operator ==(const GLPolygonOffset& other) const
+    {return factor == other.factor && units == other.units;}
+
   GLfloat  	factor;
   GLfloat  	units;
 };
 
 //////////////////////////////////////////////////////////////////////////////
 
+// registers values as text (consistency audit reports)
+inline void formatRegisterValue(char* text, size_t size, GLuint value)
+  {DOCGL_SNPRINTF(text, size, "%u", value);}
+inline void formatRegisterValue(char* text, size_t size, GLint value)
+  {DOCGL_SNPRINTF(text, size, "%d", value);}
+inline void formatRegisterValue(char* text, size_t size, GLboolean value)
+  {DOCGL_SNPRINTF(text, size, "%s", value ? "GL_TRUE" : "GL_FALSE");}
+inline void formatRegisterValue(char* text, size_t size, GLfloat value)
+  {DOCGL_SNPRINTF(text, size, "%g", value);}
+inline void formatRegisterValue(char* text, size_t size, const GLColor& value)
+  {DOCGL_SNPRINTF(text, size, "(%g, %g, %g, %g)", value.getRed(), value.getGreen(), value.getBlue(), value.getAlpha());}
+inline void formatRegisterValue(char* text, size_t size, const GLRegion& value)
+  {DOCGL_SNPRINTF(text, size, "(%d, %d, %d, %d)", value.getLeft(), value.getBottom(), value.getWidth(), value.getHeight());}
+inline void formatRegisterValue(char* text, size_t size, const GLPolygonOffset& value)
+  {DOCGL_SNPRINTF(text, size, "(%g, %g)", value.factor, value.units);}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// errors checks kinds: each clearErrorFlags/popErrorFlags call site tells what it checks.
+enum GLErrorCheck
+{
+  stateErrorCheck = 0,  // registers accesses, draw loop operations
+  resourceErrorCheck,   // objects creation, build, logs and introspection
+  failureErrorCheck     // an OpenGL call already reported a failure, or a one time probe: always polled
+};
+
+// glGetError can serialize the driver: the policy choose, at compile time, which checks really poll OpenGL errors.
+// Not polled checks are free and return succeed.
+template <int policy, size_t samplingPeriod>
+struct GLErrorPolicy
+{
+  enum {isSampled = (policy == DOCGL_ERROR_POLICY_SAMPLED)};
+
+  // numStateChecks: state checks popped so far (sampled policy)
+  static bool isPolled(GLErrorCheck check, size_t numStateChecks)
+  {
+    if (check == failureErrorCheck)
+      return true;
+    switch (policy)
+    {
+    case DOCGL_ERROR_POLICY_NEVER: return false;
+    case DOCGL_ERROR_POLICY_ON_RESOURCE_CREATION: return check == resourceErrorCheck;
+    case DOCGL_ERROR_POLICY_SAMPLED: return check == resourceErrorCheck || !(numStateChecks % samplingPeriod);
+    default: return true;
+    }
+  }
+};
+
+typedef GLErrorPolicy<DOCGL_ERROR_POLICY, DOCGL_ERROR_SAMPLING_PERIOD> GLBuildErrorPolicy;
+
+//////////////////////////////////////////////////////////////////////////////
+
 // Predeclaration
 template <typename GLPropertyType>
 class GLProperty;
 template <typename GLRegisterType>
 class GLRegister;
+struct GLImplementationLimits;
+
+// extensions used by docgl: resolved once at context initialize, tested with a single bit test.
+enum GLCapability
+{
+  separateShaderObjectsCapability = 0, // GL_ARB_separate_shader_objects (OpenGL 4.1)
+  shaderSubroutineCapability,          // GL_ARB_shader_subroutine (OpenGL 4.0)
+  debugOutputCapability,               // GL_KHR_debug (OpenGL 4.3)
+  debugOutputARBCapability,            // GL_ARB_debug_output (older drivers, ARB suffixed entry points)
+  bufferStorageCapability,             // GL_ARB_buffer_storage (OpenGL 4.4)
+  invalidateSubdataCapability,         // GL_ARB_invalidate_subdata (OpenGL 4.3)
+  numCapabilities
+};
 
 class GLContext
 {
 public:
+  GLContext()
+    : detectedCapabilities(0), forcedOffCapabilities(0), capabilities(0), numStateErrorChecks(0) {}
+
+  // extensions
+  bool hasCapability(GLCapability capability) const
+    {return (capabilities & (1u << capability)) != 0;}
+  bool isCapabilityDetected(GLCapability capability) const
+    {return (detectedCapabilities & (1u << capability)) != 0;}
+
+  // disable a detected capability (benchmarking fallback paths), before or after initialize.
+  void forceCapabilityOff(GLCapability capability, bool forcedOff = true)
+  {
+    if (forcedOff)
+      forcedOffCapabilities |= 1u << capability;
+    else
+      forcedOffCapabilities &= ~(1u << capability);
+    capabilities = detectedCapabilities & ~forcedOffCapabilities;
+  }
+
   // construction
   virtual GLErrorFlags initialize()  = 0;
   virtual bool isInitialized() const = 0;
+  virtual const GLImplementationLimits& getLimits() const = 0;
 
   // environment
   virtual const char* getVendorName() const = 0;
@@ -381,10 +642,39 @@ public:
   virtual GLRegister<GLenum>& getTextureCompressionQualityHint() = 0;
   virtual GLRegister<GLenum>& getFragmentShaderDerivativeAccuracyHint() = 0;
 
-  // error flags
+  // error flags, honouring GLBuildErrorPolicy: not polled checks return succeed without OpenGL call.
+  // clearErrorFlags before and popErrorFlags after the checked OpenGL calls, with the same check kind.
   // WARNING: When it's possible, prefer jassertglsucceed(context) to discard potential OpenGL state flushing penalty in release build.
-  virtual GLErrorFlags popErrorFlags() = 0;
-  virtual void clearErrorFlags() = 0;
+  // site (DOCGL_ERROR_HISTOGRAM): polled errors are counted in the site histogram, cleared ones as discarded.
+  GLErrorFlags popErrorFlagsAt(GLErrorSite* site, GLErrorCheck check = stateErrorCheck)
+  {
+    const bool polled = GLBuildErrorPolicy::isPolled(check, numStateErrorChecks);
+    if (GLBuildErrorPolicy::isSampled && check == stateErrorCheck)
+      ++numStateErrorChecks;
+    if (!polled)
+      return GLErrorFlags::succeed;
+    GLErrorFlags errorFlags = pollErrorFlags();
+    if (site)
+      site->record(errorFlags);
+    return errorFlags;
+  }
+  void clearErrorFlagsAt(GLErrorSite* site, GLErrorCheck check = stateErrorCheck)
+  {
+    if (!GLBuildErrorPolicy::isPolled(check, numStateErrorChecks)) // sampled: only before a polled popErrorFlags
+      return;
+    const GLErrorFlags errorFlags = pollErrorFlags();
+    if (site && errorFlags.hasErrors())
+      site->recordDiscarded(); // produced by previous unchecked calls: not this site errors
+    jassert(errorFlags.hasSucceed()); // Some errors have been discarded.
+  }
+  GLErrorFlags popErrorFlags(GLErrorCheck check = stateErrorCheck)
+    {return popErrorFlagsAt(NULL, check);}
+  void clearErrorFlags(GLErrorCheck check = stateErrorCheck)
+    {clearErrorFlagsAt(NULL, check);}
+
+  // Get context error flags ignoring the policy
+  // WARNING: potential OpenGL state flushing penalty.
+  virtual GLErrorFlags pollErrorFlags() = 0;
 
   // clear
   virtual GLRegister<GLColor>& getClearColor() = 0;
@@ -430,6 +720,7 @@ public:
   virtual bool isValidTextureSize(GLsizei size) const = 0;
   virtual bool isValidTextureBindingTarget(GLenum target) const = 0;
   virtual GLRegister<GLuint>& getActiveTextureBind(GLenum target) = 0;
+  virtual GLErrorFlags bindTexture(GLenum textureUnit, GLenum target, GLuint textureId) = 0; // textureUnit: GL_TEXTURE0 GL_TEXTURE1...
 
   // pixel store: pack=VRAM->RAM, unpack=RAM->VRAM
   virtual GLRegister<GLint>&        getPixelStoreRowByteAligment(bool packing) = 0;
@@ -456,21 +747,50 @@ public:
   virtual GLRegister<GLenum>& getActiveProgramBind() = 0;
 
   // Opengl 4.1 subroutines
-  virtual GLErrorFlags loadUniformSubroutines(GLenum shaderType, GLsizei count, const GLuint* indices) = 0; // need to be called after each getActiveProgramBind().setValue
+  virtual GLErrorFlags loadUniformSubroutines(GLenum shaderType, GLsizei count, const GLuint* indices) = 0; // need to be called after each getActiveProgramBind().setValue (cached contexts remember it per program)
   virtual GLuint getMaxSubRoutines() const = 0;
   virtual GLuint getMaxSubRoutinesUniformLocation() const = 0;
 
   // program pipeline
   virtual GLRegister<GLenum>& getActiveProgramPipelineBind() = 0;
 
+  // named objects deletion: OpenGL silently revert to zero the bindings of a deleted name.
+  // Called by GLObject before deletion to let cached contexts follow.
+  virtual void notifyTextureDeletion(GLuint textureId) = 0;
+  virtual void notifyBufferDeletion(GLuint bufferId) = 0;
+  virtual void notifyVertexArrayDeletion(GLuint vertexArrayId) = 0;
+  virtual void notifyProgramPipelineDeletion(GLuint programPipelineId) = 0;
+  virtual void notifyProgramDeletion(GLuint programId) = 0;
+
+  // called by GLProgramObject after each link.
+  virtual void notifyProgramLink(GLuint programId) = 0;
+
+  // registers deferred values (GLScopedSetValue restores on cached contexts):
+  // sent to OpenGL before operations depending on the current state (draw, clear...)
+  virtual GLErrorFlags flushPendingValues() = 0;
+
   // multi context glew abstraction
 # ifdef GLEW_MX
   virtual GLEWContext* glewGetContext() const = 0;
 # endif // GLEW_MX
+
+protected:
+  // called by concrete contexts initialize
+  void setDetectedCapabilities(GLuint detectedCapabilities)
+  {
+    this->detectedCapabilities = detectedCapabilities;
+    capabilities = detectedCapabilities & ~forcedOffCapabilities;
+  }
+
+private:
+  GLuint detectedCapabilities;
+  GLuint forcedOffCapabilities;
+  GLuint capabilities; // detected and not forced off
+  size_t numStateErrorChecks; // sampled error policy
 };
 
 # if defined(DEBUG) || defined(_DEBUG)
-#  define jassertglsucceed(context) {const GLErrorFlags errorFlags = context.popErrorFlags(); jassert(errorFlags.hasSucceed());}
+#  define jassertglsucceed(context) {const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck); jassert(errorFlags.hasSucceed());}
 # else
 #  define jassertglsucceed(context)
 # endif // ! defined(DEBUG) || defined(_DEBUG)
@@ -527,12 +847,135 @@ public:
 
   // interface
   virtual GLErrorFlags setValue(const GLType& value) = 0;
+
+  // set back a previously saved value (GLScopedSetValue): cached registers can defer it.
+  virtual GLErrorFlags restoreValue(const GLType& value)
+    {return setValue(value);}
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+# ifdef DOCGL_INSTRUMENTATION
+// per register counters (reset at each context endFrame)
+struct GLRegisterStatistics
+{
+  GLRegisterStatistics()
+    {reset();}
+
+  void reset()
+    {numSets = numRedundantSets = numForwardedSets = numQueries = 0; nanoseconds = 0;}
+
+  void merge(const GLRegisterStatistics& other)
+  {
+    numSets += other.numSets;
+    numRedundantSets += other.numRedundantSets;
+    numForwardedSets += other.numForwardedSets;
+    numQueries += other.numQueries;
+    nanoseconds += other.nanoseconds;
+  }
+
+  size_t numSets;           // setValue and restoreValue calls
+  size_t numRedundantSets;  // sets of the value OpenGL already have
+  size_t numForwardedSets;  // sets reaching OpenGL
+  size_t numQueries;        // gets reaching OpenGL
+  GLuint64 nanoseconds;     // time spent in OpenGL calls
+};
+
+// add scope duration to nanoseconds
+class GLStatisticsTimer
+{
+public:
+  GLStatisticsTimer(GLuint64& nanoseconds)
+    : nanoseconds(nanoseconds), start(std::chrono::high_resolution_clock::now()) {}
+
+  ~GLStatisticsTimer()
+    {nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();}
+
+private:
+  GLuint64& nanoseconds;
+  std::chrono::high_resolution_clock::time_point start;
+};
+# endif // DOCGL_INSTRUMENTATION
+
+// type independent cached register interface (used by contexts to sweep all their cached registers)
+class GLCachedRegisterInterface
+{
+public:
+  GLCachedRegisterInterface()
+    : selector(NULL), pending(false), deferred(false), dirtyBits(NULL), dirtyBit(0) {}
+  virtual ~GLCachedRegisterInterface() {}
+
+  // last chance methods: Warning: can produce OpenGL flushing performance penalty
+  virtual bool isConsistent() const = 0;
+  virtual GLErrorFlags makeConsistent() = 0;
+
+  // isConsistent filling both values as text on divergence (consistency audit).
+  virtual bool isConsistent(char* cachedValueText, char* openGLValueText, size_t textSize) const = 0;
+
+  // forget the cached value: next getValue or setValue will reach OpenGL.
+  virtual void invalidate() = 0;
+
+  // send the deferred value (if any) to OpenGL.
+  virtual GLErrorFlags flushPendingValue() = 0;
+  bool hasPendingValue() const
+    {return pending;}
+
+  // deferred mode: setValue only record the value like restoreValue, OpenGL receive net changes on flushPendingValue.
+  // WARNING: only for registers OpenGL read at draw/clear time, never for binds used by objects edition.
+  void setDeferred(bool deferred)
+    {this->deferred = deferred;}
+  bool isDeferred() const
+    {return deferred;}
+
+  // register selecting the OpenGL sub state this register belong to (texture unit, vertex array...)
+  void setSelector(GLCachedRegisterInterface* selector)
+    {this->selector = selector;}
+
+  // context dirty bits set: the register bit is set while a value is pending.
+  void setDirtyBit(GLuint64* dirtyBits, size_t index)
+    {this->dirtyBits = dirtyBits; dirtyBit = GLuint64(1) << index;}
+
+# ifdef DOCGL_INSTRUMENTATION
+  const GLRegisterStatistics& getStatistics() const
+    {return statistics;}
+  void resetStatistics()
+    {statistics.reset();}
+# endif // DOCGL_INSTRUMENTATION
+
+protected:
+  // the selected sub state must be the logical one before any access.
+  void flushSelector() const
+    {if (selector) selector->flushPendingValue();}
+
+  void setPending(bool pending)
+  {
+    this->pending = pending;
+    if (dirtyBits)
+      {if (pending) *dirtyBits |= dirtyBit; else *dirtyBits &= ~dirtyBit;}
+  }
+
+  GLCachedRegisterInterface* selector;
+  bool pending;
+  bool deferred;
+# ifdef DOCGL_INSTRUMENTATION
+  mutable GLRegisterStatistics statistics;
+# endif // DOCGL_INSTRUMENTATION
+
+private:
+  GLuint64* dirtyBits;
+  GLuint64 dirtyBit;
 };
 
 //////////////////////////////////////////////////////////////////////////////
 
+// Cached register:
+// - getValue never reach OpenGL while the cached value is known.
+// - setValue reach OpenGL only when the value change.
+// - restoreValue (and setValue in deferred mode) is deferred: the value is sent to OpenGL on flushPendingValue (the context flush
+//   pending values before draw/clear), and never sent if a setValue ask again the value OpenGL still have (bind/draw/restore/bind...
+//   or enable/disable/draw sequences).
 template <typename GLCachedRegisterType>
-class GLCachedRegister : public GLRegister<GLCachedRegisterType>
+class GLCachedRegister : public GLRegister<GLCachedRegisterType>, public GLCachedRegisterInterface
 {
   typedef GLCachedRegisterType GLType;
   typedef GLRegister<GLType> GLRegisterType;
@@ -542,10 +985,25 @@ public:
     : GLRegister<GLType>(decorated.getContext())
     , decorated(decorated)
     , currentValue(decorated.getDefaultValue())
+    , openGLValue(currentValue)
+    , known(true)
     {}
 
+  virtual GLType getDefaultValue() const
+    {return decorated.getDefaultValue();}
+
+  // Warning: produce OpenGL flushing performance penalty only if the cache have been invalidated.
   virtual GLErrorFlags getValue(GLType& value) const
   {
+    flushSelector();
+    if (!known)
+    {
+      DOCGL_INSTRUMENT(++statistics.numQueries; GLStatisticsTimer timer(statistics.nanoseconds);)
+      const GLErrorFlags errorFlags = decorated.getValue(value);
+      if (errorFlags.hasSucceed())
+        {currentValue = openGLValue = value; known = true;}
+      return errorFlags;
+    }
     value = currentValue;
     return GLErrorFlags::succeed;
   }
@@ -553,267 +1011,636 @@ public:
   // interface
   virtual GLErrorFlags setValue(const GLType& value)
   {
-    if (value == currentValue)
-      return GLErrorFlags::succeed;
-    const GLErrorFlags errorFlags = decorated.setValue(value);
-    if (errorFlags.hasSucceed())
+    flushSelector();
+    DOCGL_INSTRUMENT(++statistics.numSets;)
+    if (known && value == openGLValue)
+    {
+      DOCGL_INSTRUMENT(++statistics.numRedundantSets;)
       currentValue = value;
-    return errorFlags;
+      setPending(false); // the deferred value is discarded: OpenGL already have the value.
+      return GLErrorFlags::succeed;
+    }
+    if (deferred && known)
+      return deferValue(value);
+    return sendValue(value);
+  }
+
+  virtual GLErrorFlags restoreValue(const GLType& value)
+  {
+    flushSelector();
+    DOCGL_INSTRUMENT(++statistics.numSets;)
+    if (!known)
+      return sendValue(value);
+    return deferValue(value);
   }
 
+  virtual GLErrorFlags flushPendingValue()
+    {return pending ? sendValue(currentValue) : GLErrorFlags::succeed;}
+
+  // update the cache only: when OpenGL have changed the value by itself (deleted bound name...)
+  void setCachedValue(const GLType& value)
+    {currentValue = openGLValue = value; known = true; setPending(false);}
+  bool isCachedValue(const GLType& value) const
+    {return known && value == currentValue;}
+  bool getCachedValue(GLType& value) const // return false if unknown
+    {value = currentValue; return known;}
+
   // last chance methods: Warning: can produce OpenGL flushing performance penalty
   // if return false, ensure GLCachedRegister construction have been done just after OpenGL context creation.
-  bool isConsistent() const
+  virtual bool isConsistent() const
   {
+    if (!known)
+      return true; // nothing cached, nothing wrong.
     GLType value;
+    DOCGL_INSTRUMENT(++statistics.numQueries; GLStatisticsTimer timer(statistics.nanoseconds);)
     if (decorated.getValue(value).hasErrors())
       return false;
-    return value == currentValue;
+    return value == openGLValue;
+  }
+  virtual bool isConsistent(char* cachedValueText, char* openGLValueText, size_t textSize) const
+  {
+    if (isConsistent())
+      return true;
+    // divergence (rare): OpenGL value is read again to be formatted
+    formatRegisterValue(cachedValueText, textSize, openGLValue);
+    GLType value;
+    if (decorated.getValue(value).hasSucceed())
+      formatRegisterValue(openGLValueText, textSize, value);
+    else
+      DOCGL_SNPRINTF(openGLValueText, textSize, "<error>");
+    return false;
+  }
+  virtual GLErrorFlags makeConsistent()
+  {
+    GLErrorFlags errorFlags = flushPendingValue();
+    DOCGL_INSTRUMENT(++statistics.numQueries; GLStatisticsTimer timer(statistics.nanoseconds);)
+    errorFlags.merge(decorated.getValue(currentValue));
+    openGLValue = currentValue;
+    known = errorFlags.hasSucceed();
+    return errorFlags;
   }
-  GLErrorFlags makeConsistent() const
-    {return decorated.getValue(currentValue);}
+
+  virtual void invalidate()
+    {known = false; setPending(false);}
+
+  bool isKnown() const
+    {return known;}
 
 protected:
+  // send value to OpenGL
+  virtual GLErrorFlags sendValue(const GLType& value)
+  {
+    DOCGL_INSTRUMENT(++statistics.numForwardedSets; GLStatisticsTimer timer(statistics.nanoseconds);)
+    const GLErrorFlags errorFlags = decorated.setValue(value);
+    if (errorFlags.hasSucceed())
+      {currentValue = openGLValue = value; known = true; setPending(false);}
+    return errorFlags;
+  }
+
+  GLErrorFlags deferValue(const GLType& value)
+  {
+    DOCGL_INSTRUMENT(if (value == openGLValue) ++statistics.numRedundantSets;)
+    currentValue = value;
+    setPending(!(value == openGLValue));
+    return GLErrorFlags::succeed;
+  }
+
   GLRegisterType& decorated;
-  GLType currentValue;
+  mutable GLType currentValue;  // value seen by users
+  mutable GLType openGLValue;   // value really set in OpenGL (differ from currentValue while a restore is pending)
+  mutable bool known;
 };
 
 //////////////////////////////////////////////////////////////////////////////
 
-class GLIntegerConstantsStore
+// Cached register selecting an OpenGL sub state (texture unit, vertex array...):
+// an effective OpenGL value change invalidate the cached registers depending on this selection.
+template <typename GLCachedSelectorRegisterType>
+class GLCachedSelectorRegister : public GLCachedRegister<GLCachedSelectorRegisterType>
 {
+  typedef GLCachedSelectorRegisterType GLType;
+  typedef GLCachedRegister<GLType> GLCachedRegisterType;
+
 public:
-  GLIntegerConstantsStore(GLContext& context)
-    : context(context) {}
+  GLCachedSelectorRegister(GLRegister<GLType>& decorated)
+    : GLCachedRegisterType(decorated), numDependents(0) {}
 
-  // return succeed else check getFailureId to know witch id is unknown
-  GLErrorFlags set(const GLenum* constantIDs, size_t numConstants)
+  void addDependent(GLCachedRegisterInterface& dependent)
   {
-    context.clearErrorFlags();
-    for (size_t i = 0; i < numConstants; ++i)
-    {
-      const GLenum id = constantIDs[i];
-      GLErrorFlags errorFlags;
-      if (id == GL_MAX_VIEWPORT_DIMS)
-        errorFlags = getMaxViewportDims(); // special case for two dimensional int
-      else
-      {
-        GLint value;
-        glGetIntegerv(id, &value);
-        GLErrorFlags errorFlags = context.popErrorFlags();
-        if (errorFlags.hasSucceed())
-          constants[id] = value;
-      }
-      if (errorFlags.hasErrors())
-      {
-        failureId = id;
-        constants.clear();
-        return errorFlags;
-      }
-    }
-    return GLErrorFlags::succeed;
+    if (numDependents >= maxNumDependents)
+      {jassertfalse; return;} // increase maxNumDependents
+    dependents[numDependents++] = &dependent;
+    dependent.setSelector(this);
   }
 
-  // valid only if set method has failed
-  GLenum getFailureId()
-    {return failureId;}
+  virtual GLErrorFlags makeConsistent()
+  {
+    const GLType previousValue = GLCachedRegisterType::currentValue;
+    const bool wasKnown = GLCachedRegisterType::known;
+    const GLErrorFlags errorFlags = GLCachedRegisterType::makeConsistent();
+    if (!wasKnown || !GLCachedRegisterType::isCachedValue(previousValue))
+      invalidateDependents();
+    return errorFlags;
+  }
 
-  bool isConstantStored(GLenum id) const
-    {return constants.find(id) != constants.end();}
+  virtual void invalidate()
+  {
+    GLCachedRegisterType::invalidate();
+    invalidateDependents();
+  }
 
-  GLint getValue(GLenum id) const
+protected:
+  virtual GLErrorFlags sendValue(const GLType& value)
   {
-    ConstantsStore::const_iterator it = constants.find(id);
-    if (it == constants.end())
-    {
-      jassertfalse; // unknown id: check the set parameters and return value.
-      return 0;
-    }
-    return it->second;
+    // dependents deferred values concern the currently selected OpenGL sub state
+    GLErrorFlags errorFlags;
+    for (size_t i = 0; i < numDependents; ++i)
+      errorFlags.merge(dependents[i]->flushPendingValue());
+    const GLType previousValue = GLCachedRegisterType::openGLValue;
+    const bool wasKnown = GLCachedRegisterType::known;
+    errorFlags.merge(GLCachedRegisterType::sendValue(value));
+    if (errorFlags.hasSucceed())
+      selectionChanged(wasKnown, previousValue);
+    return errorFlags;
   }
 
-  // internal DOCGL property, hope than never collide with other gl constants
-  enum {GL_MAX_VIEWPORT_WIDTH = 0xBABA0000 | GL_MAX_VIEWPORT_DIMS};
-  enum {GL_MAX_VIEWPORT_HEIGHT = 0xDEAD0000 | GL_MAX_VIEWPORT_DIMS};
+  // OpenGL selection have changed: dependents cached values concern the previous selection.
+  virtual void selectionChanged(bool /* previousValueWasKnown */, const GLType& /* previousValue */)
+    {invalidateDependents();}
 
-private:
-  GLErrorFlags getMaxViewportDims()
+  void invalidateDependents()
   {
-    GLint values[2];
-    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, values);
-    const GLErrorFlags errorFlags = context.popErrorFlags();
-    if (errorFlags.hasErrors())
-      return errorFlags;
-    constants[GL_MAX_VIEWPORT_WIDTH] = values[0];
-    constants[GL_MAX_VIEWPORT_HEIGHT] = values[1];
-    return GLErrorFlags::succeed;
+    for (size_t i = 0; i < numDependents; ++i)
+      dependents[i]->invalidate();
   }
 
 private:
-  GLContext& context;
-  typedef std::map<GLenum, GLint> ConstantsStore; // [id] = value
-  ConstantsStore constants;
-  GLenum failureId;
+  enum {maxNumDependents = 16};
+  GLCachedRegisterInterface* dependents[maxNumDependents];
+  size_t numDependents;
 };
 
 //////////////////////////////////////////////////////////////////////////////
 
-class GLStringConstantsStore
+// Cached active texture unit: texture binds are saved in a [unit][target] table on unit change
+// and reloaded when the unit is selected again, instead of being invalidated.
+class GLCachedTextureUnitRegister : public GLCachedSelectorRegister<GLenum>
 {
+  typedef GLCachedSelectorRegister<GLenum> GLCachedSelectorRegisterType;
+
 public:
-  GLStringConstantsStore(GLContext& context)
-    : context(context) {}
+  GLCachedTextureUnitRegister(GLRegister<GLenum>& decorated)
+    : GLCachedSelectorRegisterType(decorated), numTextureUnits(0) {}
 
-  // return succeed else check getFailureId to know witch id is unknown
-  GLErrorFlags set(const GLenum* constantIDs, size_t numConstants)
+  // binds order define the table target index
+  void addTextureBind(GLCachedRegister<GLuint>& textureBind)
   {
-    context.clearErrorFlags();
-    for (size_t i = 0; i < numConstants; ++i)
-    {
-      const GLenum id = constantIDs[i];
-      const char* value = reinterpret_cast<const char*>(glGetString(id));
-      const GLErrorFlags errorFlags = context.popErrorFlags();
-      if (errorFlags.hasErrors())
-      {
-        failureId = id;
-        constants.clear();
-        return errorFlags;
-      }
-      constants[id] = value;
-    }
-    return GLErrorFlags::succeed;
+    addDependent(textureBind);
+    textureBinds.push_back(&textureBind);
   }
 
-  // valid only if set method has failed
-  GLenum getFailureId()
-    {return failureId;}
+  // allocate the table: call it once context numTextureUnits is known.
+  void setNumTextureUnits(GLenum numTextureUnits)
+  {
+    this->numTextureUnits = numTextureUnits;
+    table.assign(numTextureUnits * textureBinds.size(), Entry());
+  }
 
-  bool isConstantStored(GLenum id) const
-    {return constants.find(id) != constants.end();}
+  // return true if the table know that textureId is bound to targetIndex on textureUnit (GL_TEXTURE0 + i).
+  bool isTextureBound(GLenum textureUnit, size_t targetIndex, GLuint textureId) const
+  {
+    if (known && textureUnit == openGLValue)
+      return textureBinds[targetIndex]->isCachedValue(textureId);
+    const Entry* entry = getEntry(textureUnit, targetIndex);
+    return entry && entry->known && entry->textureId == textureId;
+  }
 
-  const char* getValue(GLenum id) const
+  // return true and set textureUnit if textureId is known to be bound to targetIndex on any unit.
+  bool findTextureUnit(size_t targetIndex, GLuint textureId, GLenum& textureUnit) const
   {
-    ConstantsStore::const_iterator it = constants.find(id);
-    if (it == constants.end())
-    {
-      jassertfalse; // unknown id: check the set parameters and return value.
-      return 0;
-    }
-    return it->second;
+    if (known && isTextureBound(openGLValue, targetIndex, textureId))
+      {textureUnit = openGLValue; return true;}
+    for (GLenum i = 0; i < numTextureUnits; ++i)
+      if (isTextureBound(GL_TEXTURE0 + i, targetIndex, textureId))
+        {textureUnit = GL_TEXTURE0 + i; return true;}
+    return false;
   }
 
-private:
-  GLContext& context;
-  typedef std::map<GLenum, const char*> ConstantsStore; // [id] = value
-  ConstantsStore constants;
-  GLenum failureId;
-};
+  // OpenGL unbind a deleted texture from all units
+  void textureDeleted(GLuint textureId)
+  {
+    for (size_t i = 0; i < table.size(); ++i)
+      if (table[i].known && table[i].textureId == textureId)
+        table[i].textureId = 0;
+  }
 
-//////////////////////////////////////////////////////////////////////////////
+  virtual GLErrorFlags makeConsistent()
+  {
+    invalidateTable(); // other units could have been modified too.
+    return GLCachedSelectorRegisterType::makeConsistent();
+  }
 
-class GLFloatConstantsStore
-{
-public:
-  GLFloatConstantsStore(GLContext& context)
-    : context(context) {}
+  virtual void invalidate()
+  {
+    invalidateTable();
+    GLCachedSelectorRegisterType::invalidate();
+  }
 
-  // return succeed else check getFailureId to know witch id is unknown
-  GLErrorFlags set(const GLenum* constantIDs, size_t numConstants)
+protected:
+  virtual void selectionChanged(bool previousValueWasKnown, const GLenum& previousValue)
   {
-    context.clearErrorFlags();
-    for (size_t i = 0; i < numConstants; ++i)
+    if (previousValueWasKnown)
+      for (size_t i = 0; i < textureBinds.size(); ++i)
+        if (Entry* entry = getEntry(previousValue, i))
+          entry->known = textureBinds[i]->getCachedValue(entry->textureId);
+
+    for (size_t i = 0; i < textureBinds.size(); ++i)
     {
-      const GLenum id = constantIDs[i];
-      GLErrorFlags errorFlags;
-      if (id == GL_POINT_SIZE_RANGE)
-         errorFlags = getPointSizeRange(); // special case for two dimensional float
+      const Entry* entry = getEntry(openGLValue, i);
+      if (entry && entry->known)
+        textureBinds[i]->setCachedValue(entry->textureId);
       else
-      {
-        GLfloat value;
-        glGetFloatv(id, &value);
-        errorFlags = context.popErrorFlags();
-        if (errorFlags.hasSucceed())
-          constants[id] = value;
-      }
-      if (errorFlags.hasErrors())
-      {
-        failureId = id;
-        constants.clear();
-        return errorFlags;
-      }
+        textureBinds[i]->invalidate();
     }
-    return GLErrorFlags::succeed;
   }
 
-  // valid only if set method has failed
-  GLenum getFailureId()
-    {return failureId;}
-
-  bool isConstantStored(GLenum id) const
-    {return constants.find(id) != constants.end();}
+private:
+  struct Entry
+  {
+    Entry() : textureId(0), known(false) {}
+    GLuint textureId;
+    bool known;
+  };
 
-  GLfloat getValue(GLenum id) const
+  Entry* getEntry(GLenum textureUnit, size_t targetIndex)
+    {return const_cast<Entry*>(static_cast<const GLCachedTextureUnitRegister* >(this)->getEntry(textureUnit, targetIndex));}
+  const Entry* getEntry(GLenum textureUnit, size_t targetIndex) const
   {
-    ConstantsStore::const_iterator it = constants.find(id);
-    if (it == constants.end())
-    {
-      jassertfalse; // unknown id: check the set parameters and return value.
-      return 0;
-    }
-    return it->second;
+    const GLenum unitIndex = textureUnit - GL_TEXTURE0;
+    if (unitIndex >= numTextureUnits || targetIndex >= textureBinds.size())
+      return NULL; // table not allocated yet
+    return &table[unitIndex * textureBinds.size() + targetIndex];
   }
 
-  // internal DOCGL property, hope than never collide with other gl constants
-  enum {GL_POINT_SMALLEST_SIZE = 0xBABA0000 | GL_POINT_SIZE_RANGE};
-  enum {GL_POINT_LARGEST_SIZE  = 0xDEAD0000 | GL_POINT_SIZE_RANGE};
-
-private:
-  GLErrorFlags getPointSizeRange()
+  void invalidateTable()
   {
-    GLfloat values[2];
-    glGetFloatv(GL_POINT_SIZE_RANGE, values);
-    const GLErrorFlags errorFlags = context.popErrorFlags();
-    if (errorFlags.hasErrors())
-      return errorFlags;
-    constants[GL_POINT_SMALLEST_SIZE] = values[0];
-    constants[GL_POINT_LARGEST_SIZE] = values[1];
-    return GLErrorFlags::succeed;
+    for (size_t i = 0; i < table.size(); ++i)
+      table[i].known = false;
   }
-private:
-  GLContext& context;
-  typedef std::map<GLenum, GLfloat> ConstantsStore; // [id] = value
-  ConstantsStore constants;
-  GLenum failureId;
+
+  GLenum numTextureUnits;
+  std::vector<GLCachedRegister<GLuint>* > textureBinds;
+  std::vector<Entry> table;
 };
 
 //////////////////////////////////////////////////////////////////////////////
 
-template <GLenum capability, GLboolean defaultValue = GL_FALSE>
-class GLBooleanRegister : public GLRegister<GLboolean>
+// Cached active program: subroutines selections are remembered per program and stage.
+// OpenGL forget the selection on each glUseProgram: it is reloaded (by flushSubroutines) only after an effective program change.
+class GLCachedProgramRegister : public GLCachedRegister<GLuint>
 {
+  typedef GLCachedRegister<GLuint> GLCachedRegisterType;
+
 public:
-  GLBooleanRegister(GLContext& context)
-    : GLRegister<GLboolean>(context) {}
+  GLCachedProgramRegister(GLRegister<GLuint>& decorated)
+    : GLCachedRegisterType(decorated), loadedStages(0) {}
 
-  virtual GLboolean getDefaultValue() const
-    {return defaultValue;}
+  enum {numStages = 5};
 
-  virtual GLErrorFlags setValue(const GLboolean& enabled)
+  static int getStageIndex(GLenum shaderType)
   {
-    if (enabled == GL_FALSE)
-      glDisable(capability);
-    else
-      glEnable(capability);
-    jassertglsucceed(context);
-    return GLErrorFlags::succeed;
+    switch (shaderType)
+    {
+    case GL_VERTEX_SHADER:          return 0;
+    case GL_TESS_CONTROL_SHADER:    return 1;
+    case GL_TESS_EVALUATION_SHADER: return 2;
+    case GL_GEOMETRY_SHADER:        return 3;
+    case GL_FRAGMENT_SHADER:        return 4;
+    default:                        return -1;
+    }
   }
 
-  // Warning: can produce OpenGL flushing performance penalty
-  virtual GLErrorFlags getValue(GLboolean& id) const
+  // link time validation limits (numbers of active subroutines and subroutine uniform locations per stage).
+  // link forget the previous selections.
+  void programLinked(GLuint programId, const GLint* numActiveSubroutines, const GLint* numLocations)
   {
-    context.clearErrorFlags();
+    Entry& entry = getEntry(programId);
+    entry.linked = true;
+    for (size_t i = 0; i < numStages; ++i)
+    {
+      entry.numActiveSubroutines[i] = numActiveSubroutines[i];
+      entry.numLocations[i] = numLocations[i];
+      entry.indices[i].clear();
+    }
+    if (known && openGLValue == programId)
+      loadedStages = 0;
+  }
+
+  void programDeleted(GLuint programId)
+  {
+    for (size_t i = 0; i < entries.size(); ++i)
+      if (entries[i].programId == programId)
+        {entries.erase(entries.begin() + i); return;}
+  }
+
+  // record the current program selection for shaderType: OpenGL receive it on flushSubroutines.
+  GLErrorFlags selectSubroutines(GLenum shaderType, GLsizei count, const GLuint* indices)
+  {
+    const int stage = getStageIndex(shaderType);
+    if (stage < 0)
+      {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+    if (!known || !currentValue)
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // no current program
+    if (count < 0 || (count && !indices))
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+
+    Entry& entry = getEntry(currentValue);
+    if (entry.linked)
+    {
+      if (count != entry.numLocations[stage])
+        {jassertfalse; return GLErrorFlags::invalidValueFlag;} // all the stage subroutine uniforms must be selected
+      for (GLsizei i = 0; i < count; ++i)
+        if (indices[i] >= static_cast<GLuint>(entry.numActiveSubroutines[stage]))
+          {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    }
+
+    std::vector<GLuint>& selection = entry.indices[stage];
+    if (selection.size() == static_cast<size_t>(count) && std::equal(indices, indices + count, selection.begin()))
+      return GLErrorFlags::succeed;
+    selection.assign(indices, indices + count);
+    if (openGLValue == currentValue)
+      loadedStages &= ~(1 << stage);
+    return GLErrorFlags::succeed;
+  }
+
+  // load the OpenGL current program selections not loaded yet.
+  GLErrorFlags flushSubroutines()
+  {
+    static const GLenum shaderTypes[numStages] = {GL_VERTEX_SHADER, GL_TESS_CONTROL_SHADER, GL_TESS_EVALUATION_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER};
+    if (!known || !openGLValue || loadedStages == (1 << numStages) - 1)
+      return GLErrorFlags::succeed;
+    const Entry* entry = findEntry(openGLValue);
+    if (!entry)
+      return GLErrorFlags::succeed;
+    for (size_t i = 0; i < numStages; ++i)
+    {
+      if (loadedStages & (1 << i) || entry->indices[i].empty())
+        continue;
+      glUniformSubroutinesuiv(shaderTypes[i], static_cast<GLsizei>(entry->indices[i].size()), &entry->indices[i][0]);
+      loadedStages |= 1 << i;
+    }
+    jassertglsucceed(context);
+    return GLErrorFlags::succeed;
+  }
+
+  virtual GLErrorFlags makeConsistent()
+    {loadedStages = 0; return GLCachedRegisterType::makeConsistent();}
+
+  virtual void invalidate()
+    {loadedStages = 0; GLCachedRegisterType::invalidate();}
+
+protected:
+  virtual GLErrorFlags sendValue(const GLuint& value)
+  {
+    const GLErrorFlags errorFlags = GLCachedRegisterType::sendValue(value);
+    if (errorFlags.hasSucceed())
+      loadedStages = 0; // glUseProgram reset subroutines selections
+    return errorFlags;
+  }
+
+private:
+  struct Entry
+  {
+    Entry() : programId(0), linked(false)
+    {
+      for (size_t i = 0; i < numStages; ++i)
+        numActiveSubroutines[i] = numLocations[i] = 0;
+    }
+    GLuint programId;
+    bool linked; // limits known
+    GLint numActiveSubroutines[numStages];
+    GLint numLocations[numStages];
+    std::vector<GLuint> indices[numStages];
+  };
+
+  const Entry* findEntry(GLuint programId) const
+  {
+    for (size_t i = 0; i < entries.size(); ++i)
+      if (entries[i].programId == programId)
+        return &entries[i];
+    return NULL;
+  }
+
+  Entry& getEntry(GLuint programId)
+  {
+    if (const Entry* entry = findEntry(programId))
+      return const_cast<Entry&>(*entry);
+    entries.push_back(Entry());
+    entries.back().programId = programId;
+    return entries.back();
+  }
+
+  std::vector<Entry> entries;
+  GLuint loadedStages; // stage bits: OpenGL have the current program selection
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Implementation dependent limits, read in one pass at context initialize: reads are plain member accesses.
+// Limits unsupported by the OpenGL implementation stay to zero and are recorded (see isSupported).
+struct GLImplementationLimits
+{
+  GLImplementationLimits()
+    {memset(this, 0, sizeof(*this));}
+
+  // environment
+  const char* vendorName;
+  const char* renderName;
+  const char* version;
+  const char* shadingLanguageVersion;
+
+  // viewport
+  GLint maxViewportWidth;
+  GLint maxViewportHeight;
+
+  // points
+  GLfloat pointSmallestSize;
+  GLfloat pointLargestSize;
+  GLfloat pointSizeGranularity;
+
+  // textures
+  GLint numTextureUnits;             // GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS
+  GLint maxTextureSize;
+  GLint max3dTextureSize;
+  GLint maxCubeMapTextureSize;
+  GLint maxRectangleTextureSize;
+  GLint maxArrayTextureLayers;
+  GLint maxTextureBufferSize;
+  GLfloat maxTextureLevelOfDetailBias;
+
+  // vertices
+  GLint numVertexAttributes;         // GL_MAX_VERTEX_ATTRIBS
+  GLint maxElementsVertices;
+  GLint maxElementsIndices;
+
+  // uniforms
+  GLint maxVertexUniformComponents;
+  GLint maxGeometryUniformComponents;
+  GLint maxFragmentUniformComponents;
+  GLint maxVertexUniformBlocks;
+  GLint maxGeometryUniformBlocks;
+  GLint maxFragmentUniformBlocks;
+  GLint maxCombinedUniformBlocks;
+  GLint maxUniformBufferBindings;
+  GLint maxUniformBlockSize;
+  GLint uniformBufferOffsetAlignment;
+
+  // frame buffer
+  GLint maxSamples;
+  GLint maxDrawBuffers;
+  GLint maxColorAttachments;
+  GLint maxRenderBufferSize;
+
+  // subroutines (ARB extension included in OpenGL 4.1)
+  GLint maxSubRoutines;
+  GLint maxSubRoutinesUniformLocation;
+
+  // unsupported limits names
+  enum {maxNumUnsupportedLimits = 16};
+  GLenum unsupportedLimits[maxNumUnsupportedLimits];
+  size_t numUnsupportedLimits;
+
+  bool isSupported(GLenum limitName) const
+  {
+    for (size_t i = 0; i < numUnsupportedLimits; ++i)
+      if (unsupportedLimits[i] == limitName)
+        return false;
+    return true;
+  }
+
+  // return errors only if environment strings are unavailable (no valid context).
+  // One time capability probe: errors are always polled (failureErrorCheck) whatever the error policy.
+  GLErrorFlags load(GLContext& context)
+  {
+    *this = GLImplementationLimits();
+
+    DOCGL_CLEAR_ERROR_FLAGS(context, failureErrorCheck);
+    vendorName = reinterpret_cast<const char*>(glGetString(GL_VENDOR));
+    renderName = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    shadingLanguageVersion = reinterpret_cast<const char*>(glGetString(GL_SHADING_LANGUAGE_VERSION));
+    const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, failureErrorCheck);
+    if (errorFlags.hasErrors())
+      return errorFlags;
+
+    struct IntegerLimit {GLenum name; GLint GLImplementationLimits::* member;};
+    static const IntegerLimit integerLimits[] = {
+      {GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &GLImplementationLimits::numTextureUnits},
+      {GL_MAX_TEXTURE_SIZE, &GLImplementationLimits::maxTextureSize},
+      {GL_MAX_3D_TEXTURE_SIZE, &GLImplementationLimits::max3dTextureSize},
+      {GL_MAX_CUBE_MAP_TEXTURE_SIZE, &GLImplementationLimits::maxCubeMapTextureSize},
+      {GL_MAX_RECTANGLE_TEXTURE_SIZE, &GLImplementationLimits::maxRectangleTextureSize},
+      {GL_MAX_ARRAY_TEXTURE_LAYERS, &GLImplementationLimits::maxArrayTextureLayers},
+      {GL_MAX_TEXTURE_BUFFER_SIZE, &GLImplementationLimits::maxTextureBufferSize},
+      {GL_MAX_VERTEX_ATTRIBS, &GLImplementationLimits::numVertexAttributes},
+      {GL_MAX_ELEMENTS_VERTICES, &GLImplementationLimits::maxElementsVertices},
+      {GL_MAX_ELEMENTS_INDICES, &GLImplementationLimits::maxElementsIndices},
+      {GL_MAX_VERTEX_UNIFORM_COMPONENTS, &GLImplementationLimits::maxVertexUniformComponents},
+      {GL_MAX_GEOMETRY_UNIFORM_COMPONENTS, &GLImplementationLimits::maxGeometryUniformComponents},
+      {GL_MAX_FRAGMENT_UNIFORM_COMPONENTS, &GLImplementationLimits::maxFragmentUniformComponents},
+      {GL_MAX_VERTEX_UNIFORM_BLOCKS, &GLImplementationLimits::maxVertexUniformBlocks},
+      {GL_MAX_GEOMETRY_UNIFORM_BLOCKS, &GLImplementationLimits::maxGeometryUniformBlocks},
+      {GL_MAX_FRAGMENT_UNIFORM_BLOCKS, &GLImplementationLimits::maxFragmentUniformBlocks},
+      {GL_MAX_COMBINED_UNIFORM_BLOCKS, &GLImplementationLimits::maxCombinedUniformBlocks},
+      {GL_MAX_UNIFORM_BUFFER_BINDINGS, &GLImplementationLimits::maxUniformBufferBindings},
+      {GL_MAX_UNIFORM_BLOCK_SIZE, &GLImplementationLimits::maxUniformBlockSize},
+      {GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &GLImplementationLimits::uniformBufferOffsetAlignment},
+      {GL_MAX_SAMPLES, &GLImplementationLimits::maxSamples},
+      {GL_MAX_DRAW_BUFFERS, &GLImplementationLimits::maxDrawBuffers},
+      {GL_MAX_COLOR_ATTACHMENTS, &GLImplementationLimits::maxColorAttachments},
+      {GL_MAX_RENDERBUFFER_SIZE, &GLImplementationLimits::maxRenderBufferSize},
+      {GL_MAX_SUBROUTINES, &GLImplementationLimits::maxSubRoutines},
+      {GL_MAX_SUBROUTINE_UNIFORM_LOCATIONS, &GLImplementationLimits::maxSubRoutinesUniformLocation},
+    };
+    for (size_t i = 0; i < sizeof(integerLimits) / sizeof(integerLimits[0]); ++i)
+    {
+      GLint value = 0;
+      glGetIntegerv(integerLimits[i].name, &value);
+      if (DOCGL_POP_ERROR_FLAGS(context, failureErrorCheck).hasSucceed())
+        this->*integerLimits[i].member = value;
+      else
+        addUnsupportedLimit(integerLimits[i].name);
+    }
+
+    GLfloat floatValue = 0.f;
+    glGetFloatv(GL_MAX_TEXTURE_LOD_BIAS, &floatValue);
+    if (DOCGL_POP_ERROR_FLAGS(context, failureErrorCheck).hasSucceed())
+      maxTextureLevelOfDetailBias = floatValue;
+    else
+      addUnsupportedLimit(GL_MAX_TEXTURE_LOD_BIAS);
+
+    glGetFloatv(GL_POINT_SIZE_GRANULARITY, &floatValue);
+    if (DOCGL_POP_ERROR_FLAGS(context, failureErrorCheck).hasSucceed())
+      pointSizeGranularity = floatValue;
+    else
+      addUnsupportedLimit(GL_POINT_SIZE_GRANULARITY);
+
+    // two dimensional limits
+    GLint integerValues[2] = {0, 0};
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, integerValues);
+    if (DOCGL_POP_ERROR_FLAGS(context, failureErrorCheck).hasSucceed())
+      {maxViewportWidth = integerValues[0]; maxViewportHeight = integerValues[1];}
+    else
+      addUnsupportedLimit(GL_MAX_VIEWPORT_DIMS);
+
+    GLfloat floatValues[2] = {0.f, 0.f};
+    glGetFloatv(GL_POINT_SIZE_RANGE, floatValues);
+    if (DOCGL_POP_ERROR_FLAGS(context, failureErrorCheck).hasSucceed())
+      {pointSmallestSize = floatValues[0]; pointLargestSize = floatValues[1];}
+    else
+      addUnsupportedLimit(GL_POINT_SIZE_RANGE);
+
+    return GLErrorFlags::succeed;
+  }
+
+private:
+  void addUnsupportedLimit(GLenum limitName)
+  {
+    if (numUnsupportedLimits < maxNumUnsupportedLimits)
+      unsupportedLimits[numUnsupportedLimits++] = limitName;
+    else
+      {jassertfalse;} // increase maxNumUnsupportedLimits
+  }
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+template <GLenum capability, GLboolean defaultValue = GL_FALSE>
+class GLBooleanRegister : public GLRegister<GLboolean>
+{
+public:
+  GLBooleanRegister(GLContext& context)
+    : GLRegister<GLboolean>(context) {}
+
+  virtual GLboolean getDefaultValue() const
+    {return defaultValue;}
+
+  virtual GLErrorFlags setValue(const GLboolean& enabled)
+  {
+    if (enabled == GL_FALSE)
+      glDisable(capability);
+    else
+      glEnable(capability);
+    jassertglsucceed(context);
+    return GLErrorFlags::succeed;
+  }
+
+  // Warning: can produce OpenGL flushing performance penalty
+  virtual GLErrorFlags getValue(GLboolean& id) const
+  {
+    DOCGL_CLEAR_ERROR_FLAGS(context, stateErrorCheck);
     id = glIsEnabled(capability);
-    const GLErrorFlags errorFlags = context.popErrorFlags();
+    const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck);
     jassert(errorFlags.hasSucceed());
     return errorFlags;
   }
@@ -844,9 +1671,9 @@ public:
   virtual GLErrorFlags getValue(GLenum& id) const
   {
     GLint intValue = GL_DONT_CARE;
-    context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(context, stateErrorCheck);
     glGetIntegerv(target, &intValue);
-    GLErrorFlags errorFlags = context.popErrorFlags();
+    GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck);
     if (errorFlags.hasSucceed())
     {
       if((intValue < 0) || !isValidHintMode(intValue))
@@ -880,9 +1707,9 @@ public:
   // Warning: can produce OpenGL flushing performance penalty
   virtual GLErrorFlags getValue(GLColor& color) const
   {
-    context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(context, stateErrorCheck);
     glGetFloatv(GL_COLOR_CLEAR_VALUE, color.components);
-    const GLErrorFlags errorFlags = context.popErrorFlags();
+    const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck);
     jassert(errorFlags.hasSucceed());
     return errorFlags;
   }
@@ -909,16 +1736,16 @@ public:
   // Warning: can produce OpenGL flushing performance penalty
   virtual GLErrorFlags getValue(GLPolygonOffset& polygonOffset) const
   {
-    context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(context, stateErrorCheck);
     glGetFloatv(GL_POLYGON_OFFSET_FACTOR, &polygonOffset.factor);
-    GLErrorFlags errorFlags = context.popErrorFlags();
+    GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck);
     if (!errorFlags.hasSucceed())
     {
       jassertfalse;
       return errorFlags;
     }
     glGetFloatv(GL_POLYGON_OFFSET_UNITS, &polygonOffset.units);
-    errorFlags = context.popErrorFlags();
+    errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck);
     jassert(errorFlags.hasSucceed());
     return errorFlags;
   }
@@ -943,9 +1770,9 @@ public:
   // Warning: can produce OpenGL flushing performance penalty
   virtual GLErrorFlags getValue(GLfloat& value) const
   {
-    context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(context, stateErrorCheck);
     glGetFloatv(GL_DEPTH_CLEAR_VALUE, &value);
-    GLErrorFlags errorFlags = context.popErrorFlags();
+    GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck);
     jassert(errorFlags.hasSucceed());
     return errorFlags;
   }
@@ -972,9 +1799,9 @@ public:
   // Warning: can produce OpenGL flushing performance penalty
   virtual GLErrorFlags getValue(GLint& value) const
   {
-    context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(context, stateErrorCheck);
     glGetIntegerv(GL_STENCIL_CLEAR_VALUE, &value);
-    GLErrorFlags errorFlags = context.popErrorFlags();
+    GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck);
     jassert(errorFlags.hasSucceed());
     return errorFlags;
   }
@@ -1002,9 +1829,9 @@ public:
   // Warning: can produce OpenGL flushing performance penalty
   virtual GLErrorFlags getValue(GLRegion& region) const
   {
-    context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(context, stateErrorCheck);
     glGetIntegerv(GL_VIEWPORT, region.dimensions);
-    GLErrorFlags errorFlags = context.popErrorFlags();
+    GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck);
     jassert(errorFlags.hasSucceed());
     jassert(errorFlags.hasErrors() || region.getWidth() <= context.getMaxViewportWidth());
     jassert(errorFlags.hasErrors() || region.getHeight() <= context.getMaxViewportHeight());
@@ -1035,9 +1862,9 @@ public:
   // Warning: can produce OpenGL flushing performance penalty
   virtual GLErrorFlags getValue(GLRegion& region) const
   {
-    context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(context, stateErrorCheck);
     glGetIntegerv(GL_SCISSOR_BOX, region.dimensions);
-    GLErrorFlags errorFlags = context.popErrorFlags();
+    GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck);
     jassert(errorFlags.hasSucceed());
     return errorFlags;
   }
@@ -1068,9 +1895,9 @@ public:
   virtual GLErrorFlags getValue(GLfloat& size) const
   {
     size = 1.0f;
-    context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(context, stateErrorCheck);
     glGetFloatv(GL_POINT_SIZE, &size);
-    GLErrorFlags errorFlags = context.popErrorFlags();
+    GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck);
     jassert(errorFlags.hasSucceed());
     // TODO ? check if size is in the implementation range
     return errorFlags;
@@ -1103,9 +1930,9 @@ public:
   virtual GLErrorFlags getValue(GLenum& id) const
   {
     GLint intValue = GL_TEXTURE0;
-    context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(context, stateErrorCheck);
     glGetIntegerv(GL_ACTIVE_TEXTURE, &intValue);
-    GLErrorFlags errorFlags = context.popErrorFlags();
+    GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck);
     if (errorFlags.hasSucceed())
     {
       if((intValue < 0) || !context.isValidTextureUnitIndex(intValue))
@@ -1146,9 +1973,9 @@ public:
   virtual GLErrorFlags getValue(GLuint& textureId) const
   {
     GLint intValue = 0;
-    context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(context, stateErrorCheck);
     glGetIntegerv(targetBinding, &intValue);
-    GLErrorFlags errorFlags = context.popErrorFlags();
+    GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck);
     if (errorFlags.hasSucceed())
     {
       if((intValue < 0))
@@ -1189,9 +2016,9 @@ public:
   virtual GLErrorFlags getValue(GLType& param) const
   {
     GLint intValue = defaultValue;
-    GLRegister<GLType>::context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(GLRegister<GLType>::context, stateErrorCheck);
     glGetIntegerv(name, &intValue);
-    GLErrorFlags errorFlags = GLRegister<GLType>::context.popErrorFlags();
+    GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(GLRegister<GLType>::context, stateErrorCheck);
     if (errorFlags.hasSucceed())
     {
       if ((intValue < 0) || !isValidParameter(name, intValue))
@@ -1269,19 +2096,30 @@ public:
     {return GLPixelStore();} // assume that GLPixelStore default constructor set OpenGL default values
 
   virtual GLErrorFlags setValue(const GLPixelStore& pixelStore)
+    {return setSubRegisters(pixelStore, false);}
+
+  virtual GLErrorFlags restoreValue(const GLPixelStore& pixelStore)
+    {return setSubRegisters(pixelStore, true);}
+
+private:
+  template <typename GLPixelStoreType>
+  static GLErrorFlags setSubRegister(GLRegister<GLPixelStoreType>& subRegister, const GLPixelStoreType& value, bool restoring)
+    {return restoring ? subRegister.restoreValue(value) : subRegister.setValue(value);}
+
+  GLErrorFlags setSubRegisters(const GLPixelStore& pixelStore, bool restoring)
   {
     if (!pixelStore.isValid())
       {jassertfalse; return GLErrorFlags::invalidValueFlag;}
 
     GLErrorFlags errorFlags;
-    errorFlags.merge(context.getPixelStoreRowByteAligment(packing).setValue(pixelStore.rowByteAligment));
-    errorFlags.merge(context.getPixelStorePaddedImageWidth(packing).setValue(pixelStore.optionalPaddedImageWidth));
-    errorFlags.merge(context.getPixelStorePaddedImageHeight(packing).setValue(pixelStore.optionalPaddedImageHeight));
-    errorFlags.merge(context.getPixelStoreHaveLittleEndianComponentBytesOrdering(packing).setValue(pixelStore.haveLittleEndianComponentBytesOrdering));
-    errorFlags.merge(context.getPixelStoreHaveReversedBitsOrdering(packing).setValue(pixelStore.haveReversedBitsOrdering));
-    errorFlags.merge(context.getPixelStoreNumSkippedPixels(packing).setValue(pixelStore.numSkippedPixels));
-    errorFlags.merge(context.getPixelStoreNumSkippedRows(packing).setValue(pixelStore.numSkippedRows));
-    errorFlags.merge(context.getPixelStoreNumSkippedImages(packing).setValue(pixelStore.numSkippedImages));
+    errorFlags.merge(setSubRegister(context.getPixelStoreRowByteAligment(packing), pixelStore.rowByteAligment, restoring));
+    errorFlags.merge(setSubRegister(context.getPixelStorePaddedImageWidth(packing), pixelStore.optionalPaddedImageWidth, restoring));
+    errorFlags.merge(setSubRegister(context.getPixelStorePaddedImageHeight(packing), pixelStore.optionalPaddedImageHeight, restoring));
+    errorFlags.merge(setSubRegister(context.getPixelStoreHaveLittleEndianComponentBytesOrdering(packing), pixelStore.haveLittleEndianComponentBytesOrdering, restoring));
+    errorFlags.merge(setSubRegister(context.getPixelStoreHaveReversedBitsOrdering(packing), pixelStore.haveReversedBitsOrdering, restoring));
+    errorFlags.merge(setSubRegister(context.getPixelStoreNumSkippedPixels(packing), pixelStore.numSkippedPixels, restoring));
+    errorFlags.merge(setSubRegister(context.getPixelStoreNumSkippedRows(packing), pixelStore.numSkippedRows, restoring));
+    errorFlags.merge(setSubRegister(context.getPixelStoreNumSkippedImages(packing), pixelStore.numSkippedImages, restoring));
     return errorFlags;
   }
 };
@@ -1313,9 +2151,9 @@ public:
     jassert(targetBinding != GL_TEXTURE_BINDING_BUFFER); // not tested yet
     if (targetBinding == 0)
       {jassertfalse; return GLErrorFlags::invalidEnumFlag;} // could not get current value for GL_COPY_READ_BUFFER / GL_COPY_WRITE_BUFFER (write only register)
-    context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(context, stateErrorCheck);
     glGetIntegerv(targetBinding, &intValue);
-    GLErrorFlags errorFlags = context.popErrorFlags();
+    GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck);
     if (errorFlags.hasSucceed())
     {
       if (intValue < 0)
@@ -1348,9 +2186,9 @@ public:
   virtual GLErrorFlags getValue(GLuint& vertexArrayId) const
   {
     GLint intValue = 0;
-    context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(context, stateErrorCheck);
     glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &intValue);
-    GLErrorFlags errorFlags = context.popErrorFlags();
+    GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck);
     if (errorFlags.hasSucceed())
     {
       if (intValue < 0)
@@ -1384,9 +2222,9 @@ public:
   virtual GLErrorFlags getValue(GLuint& programId) const
   {
     GLint intValue = 0;
-    context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(context, stateErrorCheck);
     glGetIntegerv(GL_CURRENT_PROGRAM, &intValue);
-    GLErrorFlags errorFlags = context.popErrorFlags();
+    GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck);
     if (errorFlags.hasSucceed())
     {
       if (intValue < 0)
@@ -1410,7 +2248,7 @@ public:
   // programId must be created by glCreateProgram
   virtual GLErrorFlags setValue(const GLuint& programId)
   {
-    if (!GLEW_ARB_separate_shader_objects)
+    if (!context.hasCapability(separateShaderObjectsCapability))
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;}  // this is not an OpenGL3.3 feature (ARB extension included in OpenGL 4.1)
     glBindProgramPipeline(programId);
     jassertglsucceed(context);
@@ -1421,12 +2259,12 @@ public:
   // Warning: possible OpenGL flush performance penalty.
   virtual GLErrorFlags getValue(GLuint& programId) const
   {
-    if (!GLEW_ARB_separate_shader_objects)
+    if (!context.hasCapability(separateShaderObjectsCapability))
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;}  // this is not an OpenGL3.3 feature (ARB extension included in OpenGL 4.1)
     GLint intValue = 0;
-    context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(context, stateErrorCheck);
     glGetIntegerv(GL_PROGRAM_PIPELINE_BINDING, &intValue);
-    GLErrorFlags errorFlags = context.popErrorFlags();
+    GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck);
     if (errorFlags.hasSucceed())
     {
       if (intValue < 0)
@@ -1444,6 +2282,8 @@ public:
 // Concret GLContext with direct (non cached) OpenGL context access.
 class GLDirectContext : public GLContext
 {
+  friend struct GLDirectPolicy;
+
 public:
 
 #ifdef _MSC_VER
@@ -1452,7 +2292,7 @@ public:
 #endif // ! _MSC_VER
 
   GLDirectContext()
-    : initialized(false), integerConstantsStore(*this), stringConstantsStore(*this), floatConstantsStore(*this)
+    : initialized(false)
 
     , lineSmoothHint(*this), polygonSmoothHint(*this)
     , textureCompressionQualityHint(*this), fragmentShaderDerivativeAccuracyHint(*this)
@@ -1504,40 +2344,23 @@ public:
 
   GLErrorFlags initialize()
   {
-    clearErrorFlags();
-    static const GLenum glIntegerConstants[] = {
-      GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS,  // for getNumTextureUnits
-      GL_MAX_TEXTURE_SIZE,                  // for getMaxTextureSize
-      GL_MAX_VERTEX_ATTRIBS,                // for getNumVertexAttributes
-      GL_MAX_VIEWPORT_DIMS,                 // for GL_MAX_VIEWPORT_WIDTH GL_MAX_VIEWPORT_HEIGHT -> get
-      };
-    GLErrorFlags errorFlags = integerConstantsStore.set(glIntegerConstants, sizeof(glIntegerConstants) / sizeof(glIntegerConstants[0]));
-    if (errorFlags.hasErrors())
-      return errorFlags;
-
-    static const GLenum gl4_1_IntegerConstants[] = {
-      GL_MAX_SUBROUTINES,
-      GL_MAX_SUBROUTINE_UNIFORM_LOCATIONS,
-    };
-    errorFlags = integerConstantsStore.set(gl4_1_IntegerConstants, sizeof(gl4_1_IntegerConstants) / sizeof(gl4_1_IntegerConstants[0]));
-    jassert(errorFlags.hasSucceed()); // context does'nt support openGL 4.1
-
-    static const GLenum glStringConstants[] = {
-      GL_VENDOR,                  // for getVendorName
-      GL_RENDERER,                // for getRenderName
-      GL_VERSION,                 // for getVersion
-      GL_SHADING_LANGUAGE_VERSION,// for getShadingLanguageVersion
-    };
-    errorFlags = stringConstantsStore.set(glStringConstants, sizeof(glStringConstants) / sizeof(glStringConstants[0]));
-    if (errorFlags.hasErrors())
-      return errorFlags;
-
-    static const GLenum glFloatConstants[] = {
-      GL_POINT_SIZE_RANGE,        // for GL_POINT_SMALLEST_SIZE GL_POINT_LARGEST_SIZE -> get
-      GL_POINT_SIZE_GRANULARITY,  // for getPointSizeGranularity
-    };
-
-    errorFlags = floatConstantsStore.set(glFloatConstants, sizeof(glFloatConstants) / sizeof(glFloatConstants[0]));
+    GLuint detectedCapabilities = 0;
+    if (GLEW_ARB_separate_shader_objects)
+      detectedCapabilities |= 1u << separateShaderObjectsCapability;
+    if (GLEW_ARB_shader_subroutine)
+      detectedCapabilities |= 1u << shaderSubroutineCapability;
+    if (GLEW_KHR_debug)
+      detectedCapabilities |= 1u << debugOutputCapability;
+    if (GLEW_ARB_debug_output)
+      detectedCapabilities |= 1u << debugOutputARBCapability;
+    if (GLEW_ARB_buffer_storage)
+      detectedCapabilities |= 1u << bufferStorageCapability;
+    if (GLEW_ARB_invalidate_subdata)
+      detectedCapabilities |= 1u << invalidateSubdataCapability;
+    setDetectedCapabilities(detectedCapabilities);
+
+    const GLErrorFlags errorFlags = limits.load(*this);
+    jassert(limits.isSupported(GL_MAX_SUBROUTINES)); // context does'nt support openGL 4.1
     if (errorFlags.hasSucceed())
       initialized = true;
     return errorFlags;
@@ -1545,20 +2368,21 @@ public:
 
   virtual bool isInitialized() const
     {return initialized;}
+  virtual const GLImplementationLimits& getLimits() const
+    {return limits;}
 
   // environment
   virtual const char* getVendorName() const
-    {return stringConstantsStore.getValue(GL_VENDOR);}
+    {return limits.vendorName;}
   virtual const char* getRenderName() const
-    {return stringConstantsStore.getValue(GL_RENDERER);}
+    {return limits.renderName;}
   virtual const char* getVersion() const
-    {return stringConstantsStore.getValue(GL_VERSION);}
+    {return limits.version;}
   virtual const char* getShadingLanguageVersion() const
-    {return stringConstantsStore.getValue(GL_SHADING_LANGUAGE_VERSION);}
+    {return limits.shadingLanguageVersion;}
 
-  // Get context error flags
-  // WARNING: When it's possible, prefer jassertglsucceed(context) to discard potential OpenGL state flushing penalty in release build.
-  virtual GLErrorFlags popErrorFlags()
+  // Get context error flags, whatever the error policy
+  virtual GLErrorFlags pollErrorFlags()
   {
     GLErrorFlags returnValue;
     GLenum error;
@@ -1595,14 +2419,6 @@ public:
     return returnValue;
   }
 
-  // Clear context error flags
-  // WARNING: potential OpenGL state flushing penalty.
-  virtual void clearErrorFlags()
-  {
-    const GLErrorFlags errorFlags = popErrorFlags();
-    jassert(errorFlags.hasSucceed()); // Some errors have been discarded.
-  }
-
   // hints
   virtual GLRegister<GLenum>& getLineSmoothHint()
     {return lineSmoothHint;}
@@ -1624,9 +2440,10 @@ public:
   {
     if (mask & ~(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT))
       return GLErrorFlags::invalidValueFlag;
-    clearErrorFlags();
+    flushPendingValues();
+    DOCGL_CLEAR_ERROR_FLAGS(*this, stateErrorCheck);
     glClear(mask);
-    const GLErrorFlags errorFlags = popErrorFlags();
+    const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(*this, stateErrorCheck);
     jassert(errorFlags.hasSucceed());
     return errorFlags;
   }
@@ -1635,9 +2452,9 @@ public:
   virtual GLRegister<GLRegion>& getActiveViewport()
     {return activeViewport;}
   virtual GLint getMaxViewportWidth() const
-    {return integerConstantsStore.getValue(GLIntegerConstantsStore::GL_MAX_VIEWPORT_WIDTH);}
+    {return limits.maxViewportWidth;}
   virtual GLint getMaxViewportHeight() const
-    {return integerConstantsStore.getValue(GLIntegerConstantsStore::GL_MAX_VIEWPORT_HEIGHT);}
+    {return limits.maxViewportHeight;}
 
   // scissor
   virtual GLRegister<GLRegion>& getActiveScissor()
@@ -1651,11 +2468,11 @@ public:
 
   // points
   virtual GLfloat getPointSmallestSize() const
-    {return floatConstantsStore.getValue(GLFloatConstantsStore::GL_POINT_SMALLEST_SIZE);}
+    {return limits.pointSmallestSize;}
   virtual GLfloat getPointLargestSize() const
-    {return floatConstantsStore.getValue(GLFloatConstantsStore::GL_POINT_LARGEST_SIZE);}
+    {return limits.pointLargestSize;}
   virtual GLfloat getPointSizeGranularity() const
-    {return floatConstantsStore.getValue(GL_POINT_SIZE_GRANULARITY);}
+    {return limits.pointSizeGranularity;}
   virtual GLRegister<GLboolean>& getPointSizeProgrammable()
     {return pointSizeProgrammable;}
   virtual GLRegister<GLfloat>& getPointSize()
@@ -1677,7 +2494,7 @@ public:
 
   // multitexture
   virtual GLenum getNumTextureUnits() const
-    {return integerConstantsStore.getValue(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS);}
+    {return limits.numTextureUnits;}
   virtual bool isValidTextureUnitIndex(GLenum index) const
     {return (index >= GL_TEXTURE0 && index <= (GL_TEXTURE0 + getNumTextureUnits()));}
   virtual GLRegister<GLenum>& getActiveTextureUnit()
@@ -1685,7 +2502,7 @@ public:
 
   // texture
   virtual size_t getMaxTextureSize() const
-    {return integerConstantsStore.getValue(GL_MAX_TEXTURE_SIZE);}
+    {return limits.maxTextureSize;}
   virtual bool isValidTextureSize(GLsizei size) const
     {return size >= 0 && (size_t)size <= getMaxTextureSize();}
   virtual bool isValidTextureBindingTarget(GLenum target) const
@@ -1725,6 +2542,16 @@ public:
     }
   }
 
+  virtual GLErrorFlags bindTexture(GLenum textureUnit, GLenum target, GLuint textureId)
+  {
+    if (!isValidTextureUnitIndex(textureUnit) || !isValidTextureBindingTarget(target))
+      {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+    const GLErrorFlags errorFlags = getActiveTextureUnit().setValue(textureUnit);
+    if (errorFlags.hasErrors())
+      return errorFlags;
+    return getActiveTextureBind(target).setValue(textureId);
+  }
+
   // pixel pack: VRAM->RAM, unpack: RAM->VRAM
   virtual GLRegister<GLint>& getPixelStoreRowByteAligment(bool packing)
     {if (packing) return pixelStorePackRowByteAligment; else return pixelStoreUnPackRowByteAligment;}
@@ -1785,7 +2612,7 @@ public:
   virtual bool isValidVertexAttributeIndex(GLuint index)
     {return index < getNumVertexAttributes();}
   virtual GLuint getNumVertexAttributes() const
-    {return integerConstantsStore.getValue(GL_MAX_VERTEX_ATTRIBS);}
+    {return limits.numVertexAttributes;}
   virtual GLRegister<GLuint>& getActiveVertexArrayBind()
     {return activeVertexArrayBind;}
 
@@ -1799,28 +2626,47 @@ public:
 
   virtual GLErrorFlags loadUniformSubroutines(GLenum shaderType, GLsizei count, const GLuint* indices)
   {
-    if (!GLEW_ARB_shader_subroutine)
+    if (!hasCapability(shaderSubroutineCapability))
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // // this is not an OpenGL3.3 feature (ARB extension included in OpenGL 4.1)
     if (!isValidShaderType(shaderType))
       return GLErrorFlags::invalidEnumFlag;
     // TODO assert count == GL_ACTIVE_SUBROUTINE_UNIFORM_LOCATIONS
     // TODO assert indices[*] <= GL_ACTIVE_SUBROUTINES
-    clearErrorFlags();
+    flushPendingValues(); // subroutines are loaded in the current program
+    DOCGL_CLEAR_ERROR_FLAGS(*this, stateErrorCheck);
     glUniformSubroutinesuiv(shaderType, count, indices);
-    const GLErrorFlags errorFlags = popErrorFlags();
+    const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(*this, stateErrorCheck);
     jassert(errorFlags.hasSucceed());
     return errorFlags;
   }
 
   virtual GLuint getMaxSubRoutines() const
-    {return integerConstantsStore.getValue(GL_MAX_SUBROUTINES);}
+    {return limits.maxSubRoutines;}
   virtual GLuint getMaxSubRoutinesUniformLocation() const
-    {return integerConstantsStore.getValue(GL_MAX_SUBROUTINE_UNIFORM_LOCATIONS);}
+    {return limits.maxSubRoutinesUniformLocation;}
 
   // program pipeline
   virtual GLRegister<GLenum>& getActiveProgramPipelineBind()
     {return activeProgramPipelineBind;}
 
+  // named objects deletion: nothing to follow without cache.
+  virtual void notifyTextureDeletion(GLuint /* textureId */)
+    {}
+  virtual void notifyBufferDeletion(GLuint /* bufferId */)
+    {}
+  virtual void notifyVertexArrayDeletion(GLuint /* vertexArrayId */)
+    {}
+  virtual void notifyProgramPipelineDeletion(GLuint /* programPipelineId */)
+    {}
+  virtual void notifyProgramDeletion(GLuint /* programId */)
+    {}
+  virtual void notifyProgramLink(GLuint /* programId */)
+    {}
+
+  // deferred values: nothing is deferred without cache.
+  virtual GLErrorFlags flushPendingValues()
+    {return GLErrorFlags::succeed;}
+
 # ifdef GLEW_MX
   virtual GLEWContext* glewGetContext() const
     {return const_cast<GLEWContext*>(&glewContext);}
@@ -1829,9 +2675,7 @@ public:
 protected:
   // Implementation Dependent globals
   bool initialized;
-  GLIntegerConstantsStore integerConstantsStore;
-  GLStringConstantsStore stringConstantsStore;
-  GLFloatConstantsStore floatConstantsStore;
+  GLImplementationLimits limits;
 
   // hints
   GLHint<GL_LINE_SMOOTH_HINT> lineSmoothHint;
@@ -1907,7 +2751,7 @@ protected:
   // buffer
   GLActiveBufferBind<GL_ARRAY_BUFFER, GL_ARRAY_BUFFER_BINDING>                            activeBufferForArray;
   GLActiveBufferBind<GL_COPY_READ_BUFFER>                                                 activeBufferForCopyRead;
-  GLActiveBufferBind<GL_COPY_READ_BUFFER>                                                 activeBufferForCopyWrite;
+  GLActiveBufferBind<GL_COPY_WRITE_BUFFER>                                                activeBufferForCopyWrite;
   GLActiveBufferBind<GL_ELEMENT_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER_BINDING>            activeBufferForElementArray;
   GLActiveBufferBind<GL_PIXEL_PACK_BUFFER, GL_PIXEL_PACK_BUFFER_BINDING>                  activeBufferForPixelPack;
   GLActiveBufferBind<GL_PIXEL_UNPACK_BUFFER, GL_PIXEL_UNPACK_BUFFER_BINDING>              activeBufferForPixelUnPack;
@@ -1932,355 +2776,2027 @@ protected:
 
 //////////////////////////////////////////////////////////////////////////////
 
-struct GLPackedImage
+// Concret GLContext with cached (shadowed) OpenGL context access:
+// redundant setValue never reach OpenGL and getValue never produce OpenGL flushing performance penalty.
+// WARNING: OpenGL state must only be modified through this context, else call makeConsistent after foreign OpenGL calls.
+class GLCachedContext : public GLDirectContext
 {
-  GLPackedImage()
-    : data(0) {}
+  friend struct GLCachedPolicy;
 
-  // manual initializing
-  void set(GLenum format, GLenum type, GLvoid* data)
-  {
-    this->format = format;
-    this->type = type;
-    this->data = data;
-    jassert(isValid());
+public:
+  GLCachedContext()
+    : cachedLineSmoothHint(lineSmoothHint), cachedPolygonSmoothHint(polygonSmoothHint)
+    , cachedTextureCompressionQualityHint(textureCompressionQualityHint), cachedFragmentShaderDerivativeAccuracyHint(fragmentShaderDerivativeAccuracyHint)
+
+    , cachedClearColor(clearColor), cachedClearDepth(clearDepth), cachedClearStencil(clearStencil)
+    , cachedActiveViewport(activeViewport), cachedActiveScissor(activeScissor), cachedScissorTest(scissorTest)
+
+    , cachedDepthTest(depthTest)
+
+    , cachedPointSizeProgrammable(pointSizeProgrammable), cachedPointSize(pointSize), cachedPointPolygonOffset(pointPolygonOffset)
+
+    , cachedLinePolygonOffset(linePolygonOffset)
+
+    , cachedCullFace(cullFace)
+    , cachedFillPolygonOffset(fillPolygonOffset)
+    , cachedPolygonOffset(polygonOffset)
+
+    , cachedActiveTextureUnit(activeTextureUnit), cachedActiveTexture1d(activeTexture1d), cachedActiveTexture2d(activeTexture2d)
+    , cachedActiveTexture3d(activeTexture3d), cachedActiveTexture1dArray(activeTexture1dArray), cachedActiveTexture2dArray(activeTexture2dArray)
+    , cachedActiveTextureRectangle(activeTextureRectangle), cachedActiveTextureBuffer(activeTextureBuffer), cachedActiveTextureCubeMap(activeTextureCubeMap)
+    , cachedActiveTexture2dMultisample(activeTexture2dMultisample), cachedActiveTexture2dMultisampleArray(activeTexture2dMultisampleArray)
+
+    , cachedPixelStorePackRowByteAligment(pixelStorePackRowByteAligment), cachedPixelStorePackPaddedImageWidth(pixelStorePackPaddedImageWidth)
+    , cachedPixelStorePackPaddedImageHeight(pixelStorePackPaddedImageHeight), cachedPixelStorePackHaveLittleEndianComponentBytesOrdering(pixelStorePackHaveLittleEndianComponentBytesOrdering)
+    , cachedPixelStorePackHaveReversedBitsOrdering(pixelStorePackHaveReversedBitsOrdering), cachedPixelStorePackNumSkippedPixels(pixelStorePackNumSkippedPixels)
+    , cachedPixelStorePackNumSkippedRows(pixelStorePackNumSkippedRows), cachedPixelStorePackNumSkippedImages(pixelStorePackNumSkippedImages)
+    , cachedPixelStoreUnPackRowByteAligment(pixelStoreUnPackRowByteAligment), cachedPixelStoreUnPackPaddedImageWidth(pixelStoreUnPackPaddedImageWidth)
+    , cachedPixelStoreUnPackPaddedImageHeight(pixelStoreUnPackPaddedImageHeight), cachedPixelStoreUnPackHaveLittleEndianComponentBytesOrdering(pixelStoreUnPackHaveLittleEndianComponentBytesOrdering)
+    , cachedPixelStoreUnPackHaveReversedBitsOrdering(pixelStoreUnPackHaveReversedBitsOrdering), cachedPixelStoreUnPackNumSkippedPixels(pixelStoreUnPackNumSkippedPixels)
+    , cachedPixelStoreUnPackNumSkippedRows(pixelStoreUnPackNumSkippedRows), cachedPixelStoreUnPackNumSkippedImages(pixelStoreUnPackNumSkippedImages)
+
+    , cachedActiveBufferForArray(activeBufferForArray), cachedActiveBufferForCopyRead(activeBufferForCopyRead)
+    , cachedActiveBufferForCopyWrite(activeBufferForCopyWrite), cachedActiveBufferForElementArray(activeBufferForElementArray)
+    , cachedActiveBufferForPixelPack(activeBufferForPixelPack), cachedActiveBufferForPixelUnPack(activeBufferForPixelUnPack)
+    , cachedActiveBufferForTexture(activeBufferForTexture), cachedActiveBufferForTransformFeedback(activeBufferForTransformFeedback)
+    , cachedActiveBufferForUniform(activeBufferForUniform)
+
+    , cachedActiveVertexArrayBind(activeVertexArrayBind)
+
+    , cachedActiveProgramBind(activeProgramBind)
+
+    , cachedActiveProgramPipelineBind(activeProgramPipelineBind)
+
+    , dirtyBits(0), deferredMode(false)
+    , auditCursor(0), numAuditedRegistersPerFrame(0), auditReportFunction(NULL), auditUserData(NULL)
+# ifdef DOCGL_INSTRUMENTATION
+    , frameIndex(0)
+# endif // DOCGL_INSTRUMENTATION
+  {
+    // cached registers in consistency sweep and flush order: draw states are grouped, selectors are before their dependents.
+    GLCachedRegisterInterface* const registers[numCachedRegisters] = {
+      &cachedLineSmoothHint, &cachedPolygonSmoothHint, &cachedTextureCompressionQualityHint, &cachedFragmentShaderDerivativeAccuracyHint,
+      &cachedClearColor, &cachedClearDepth, &cachedClearStencil,
+      &cachedActiveViewport, &cachedActiveScissor, &cachedScissorTest,
+      &cachedDepthTest,
+      &cachedPointSizeProgrammable, &cachedPointSize, &cachedPointPolygonOffset,
+      &cachedLinePolygonOffset,
+      &cachedCullFace, &cachedFillPolygonOffset, &cachedPolygonOffset,
+      &cachedActiveTextureUnit,
+      &cachedActiveTexture1d, &cachedActiveTexture2d, &cachedActiveTexture3d,
+      &cachedActiveTexture1dArray, &cachedActiveTexture2dArray, &cachedActiveTextureRectangle,
+      &cachedActiveTextureBuffer, &cachedActiveTextureCubeMap,
+      &cachedActiveTexture2dMultisample, &cachedActiveTexture2dMultisampleArray,
+      &cachedPixelStorePackRowByteAligment, &cachedPixelStorePackPaddedImageWidth,
+      &cachedPixelStorePackPaddedImageHeight, &cachedPixelStorePackHaveLittleEndianComponentBytesOrdering,
+      &cachedPixelStorePackHaveReversedBitsOrdering, &cachedPixelStorePackNumSkippedPixels,
+      &cachedPixelStorePackNumSkippedRows, &cachedPixelStorePackNumSkippedImages,
+      &cachedPixelStoreUnPackRowByteAligment, &cachedPixelStoreUnPackPaddedImageWidth,
+      &cachedPixelStoreUnPackPaddedImageHeight, &cachedPixelStoreUnPackHaveLittleEndianComponentBytesOrdering,
+      &cachedPixelStoreUnPackHaveReversedBitsOrdering, &cachedPixelStoreUnPackNumSkippedPixels,
+      &cachedPixelStoreUnPackNumSkippedRows, &cachedPixelStoreUnPackNumSkippedImages,
+      &cachedActiveVertexArrayBind,
+      &cachedActiveBufferForArray, &cachedActiveBufferForCopyRead, &cachedActiveBufferForCopyWrite,
+      &cachedActiveBufferForElementArray, &cachedActiveBufferForPixelPack, &cachedActiveBufferForPixelUnPack,
+      &cachedActiveBufferForTexture, &cachedActiveBufferForTransformFeedback, &cachedActiveBufferForUniform,
+      &cachedActiveProgramBind,
+      &cachedActiveProgramPipelineBind};
+    std::copy(registers, registers + numCachedRegisters, cachedRegisters);
+
+    jassert(numCachedRegisters <= sizeof(dirtyBits) * 8);
+    for (size_t i = 0; i < numCachedRegisters; ++i)
+      getCachedRegister(i).setDirtyBit(&dirtyBits, i);
+
+    // texture binds are texture unit states, element array buffer bind is a vertex array state.
+    for (size_t i = 0; i < numTextureBindingTargets; ++i)
+      cachedActiveTextureUnit.addTextureBind(getCachedTextureBind(i));
+    cachedActiveVertexArrayBind.addDependent(cachedActiveBufferForElementArray);
+  }
+
+  // load OpenGL current values: viewport and scissor default values depend on the window.
+  virtual GLErrorFlags initialize()
+  {
+    const GLErrorFlags errorFlags = GLDirectContext::initialize();
+    if (errorFlags.hasErrors())
+      return errorFlags;
+    cachedActiveTextureUnit.setNumTextureUnits(getNumTextureUnits());
+    return makeConsistent();
   }
 
-  // floating initializing helper
-  void setR(GLfloat* data)
-    {set(GL_RED, GL_FLOAT, data);}
-  void setRG(GLfloat* data)
-    {set(GL_RG, GL_FLOAT, data);}
-  void setRGB(GLfloat* data)
-    {set(GL_RGB, GL_FLOAT, data);}
-  void setRGBA(GLfloat* data)
-    {set(GL_RGBA, GL_FLOAT, data);}
-  void setBGRA(GLfloat* data)
-    {set(GL_BGRA, GL_FLOAT, data);}
+  // hints
+  virtual GLRegister<GLenum>& getLineSmoothHint()
+    {return cachedLineSmoothHint;}
+  virtual GLRegister<GLenum>& getPolygonSmoothHint()
+    {return cachedPolygonSmoothHint;}
+  virtual GLRegister<GLenum>& getTextureCompressionQualityHint()
+    {return cachedTextureCompressionQualityHint;}
+  virtual GLRegister<GLenum>& getFragmentShaderDerivativeAccuracyHint()
+    {return cachedFragmentShaderDerivativeAccuracyHint;}
 
-  // unsigned byte initializing helper
-  void setR(GLubyte* data)
-    {set(GL_RED, GL_UNSIGNED_BYTE, data);}
-  void setRG(GLubyte* data)
-    {set(GL_RG, GL_UNSIGNED_BYTE, data);}
-  void setRGB(GLubyte* data)
-    {set(GL_RGB, GL_UNSIGNED_BYTE, data);}
-  void setRGBA(GLubyte* data)
-    {set(GL_RGBA, GL_UNSIGNED_BYTE, data);}
-  void setBGRA(GLubyte* data)
-    {set(GL_BGRA, GL_UNSIGNED_BYTE, data);}
+  // clear
+  virtual GLRegister<GLColor>& getClearColor()
+    {return cachedClearColor;}
+  virtual GLRegister<GLfloat>& getClearDepth()
+    {return cachedClearDepth;}
+  virtual GLRegister<GLint>& getClearStencil()
+    {return cachedClearStencil;}
 
-  // Validation
-  static bool isValidFormat(GLenum format) // extend if needed
-    {return format == GL_RED || format == GL_RG || format == GL_RGB || format == GL_RGBA || format == GL_BGRA;}
-  static bool isValidType(GLenum type) // extend if needed
-    {return type == GL_FLOAT || type == GL_UNSIGNED_BYTE;}
-  bool isValid() const
-  {
-    bool valid = pixelStore.isValid();
-    if (!valid)
-      {jassertfalse; return false;}
-    valid = isValidFormat(format);
-    if (!valid)
-      {jassertfalse; return false;}
-    valid = isValidType(type);
-    if (!valid)
-      {jassertfalse; return false;}
-    valid = data != NULL;
-    if (!valid)
-      {jassertfalse; return false;}
-    return valid;
-  }
+  // viewport
+  virtual GLRegister<GLRegion>& getActiveViewport()
+    {return cachedActiveViewport;}
 
-  // return component count or zero on error
-  static size_t getNumComponents(GLenum format)
+  // scissor
+  virtual GLRegister<GLRegion>& getActiveScissor()
+    {return cachedActiveScissor;}
+  virtual GLRegister<GLboolean>& getScissorTest()
+    {return cachedScissorTest;}
+
+  // depth
+  virtual GLRegister<GLboolean>& getDepthTest()
+    {return cachedDepthTest;}
+
+  // points
+  virtual GLRegister<GLboolean>& getPointSizeProgrammable()
+    {return cachedPointSizeProgrammable;}
+  virtual GLRegister<GLfloat>& getPointSize()
+    {return cachedPointSize;}
+  virtual GLRegister<GLboolean>& getPointPolygonOffset()
+    {return cachedPointPolygonOffset;}
+
+  // line
+  virtual GLRegister<GLboolean>& getLinePolygonOffset()
+    {return cachedLinePolygonOffset;}
+
+  // polygon
+  virtual GLRegister<GLboolean>& getCullFace()
+    {return cachedCullFace;}
+  virtual GLRegister<GLboolean>& getFillPolygonOffset()
+    {return cachedFillPolygonOffset;}
+  virtual GLRegister<GLPolygonOffset>& getPolygonOffset()
+    {return cachedPolygonOffset;}
+
+  // multitexture
+  virtual GLRegister<GLenum>& getActiveTextureUnit()
+    {return cachedActiveTextureUnit;}
+
+  // texture
+  virtual GLRegister<GLuint>& getActiveTextureBind(GLenum target)
   {
-    switch (format)
+    switch(target)
     {
-    case GL_RED:
-      return 1;
-    case GL_RG:
-      return 2;
-    case GL_RGB:
-      return 3;
-    case GL_RGBA:
-    case GL_BGRA:
-      return 4;
-    default:
-      jassertfalse; // unknown or deprecated format: extend if needed.
-      return 0;
+    case GL_TEXTURE_1D: return cachedActiveTexture1d;
+    case GL_TEXTURE_2D: return cachedActiveTexture2d;
+    case GL_TEXTURE_3D: return cachedActiveTexture3d;
+    case GL_TEXTURE_1D_ARRAY: return cachedActiveTexture1dArray;
+    case GL_TEXTURE_2D_ARRAY: return cachedActiveTexture2dArray;
+    case GL_TEXTURE_RECTANGLE: return cachedActiveTextureRectangle;
+    case GL_TEXTURE_BUFFER: return cachedActiveTextureBuffer;
+    case GL_TEXTURE_CUBE_MAP: return cachedActiveTextureCubeMap;
+    case GL_TEXTURE_2D_MULTISAMPLE: return cachedActiveTexture2dMultisample;
+    case GL_TEXTURE_2D_MULTISAMPLE_ARRAY: return cachedActiveTexture2dMultisampleArray;
+    default: jassertfalse; return *reinterpret_cast<GLRegister<GLuint>* >(NULL); // check isValidTextureBindingTarget before call
     }
   }
-  size_t getNumComponents() const
-    {return getNumComponents(format);}
 
-  // return pixel size in byte or zero on error
-  static size_t getPixelSize(GLenum format, GLenum type)
+  // no OpenGL call at all if textureId is already bound on textureUnit, even if textureUnit is not the active one.
+  virtual GLErrorFlags bindTexture(GLenum textureUnit, GLenum target, GLuint textureId)
   {
-    const size_t numComponent = getNumComponents(format);
-    switch (type)
-    {
-    case GL_FLOAT: return numComponent * sizeof(GLfloat);
-    case GL_UNSIGNED_BYTE: return numComponent * sizeof(GLubyte);
-    default:
-      jassertfalse; // unknown or deprecated type: extend if needed.
-      return 0;
-    }
+    if (!isValidTextureBindingTarget(target))
+      {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+    if (cachedActiveTextureUnit.isTextureBound(textureUnit, getTextureBindingTargetIndex(target), textureId))
+      return GLErrorFlags::succeed;
+    return GLDirectContext::bindTexture(textureUnit, target, textureId);
   }
-  size_t getPixelSize() const
-    {return getPixelSize(format, type);}
-
-  GLPixelStore pixelStore;
-  GLenum  format;
-  GLenum  type;
-  GLvoid* data;
-};
-
-//////////////////////////////////////////////////////////////////////////////
-
-class GLObject
-{
-public:
-  GLObject(GLContext& context)
-    : context(context), id(0) {}
 
-  virtual ~GLObject()
+  // return true and set textureUnit (GL_TEXTURE0 + i) if textureId is known to be bound on target of any unit.
+  bool findTextureUnit(GLenum target, GLuint textureId, GLenum& textureUnit) const
   {
-    jassert(id == 0) // VRAM leak? Call destroy() or setId(0) on your object before destruction.
-    // TODO check binding
+    if (!isValidTextureBindingTarget(target))
+      {jassertfalse; return false;}
+    return cachedActiveTextureUnit.findTextureUnit(getTextureBindingTargetIndex(target), textureId, textureUnit);
   }
 
-  // Construct custom object (check isValid after a non-zero set)
-  // To discard destructor assert when object is used as a 'reference', unlink object from openGL named Object with setId(0)
-  void setId(GLuint id)
-    {this->id = id;}
+  // pixel pack: VRAM->RAM, unpack: RAM->VRAM
+  virtual GLRegister<GLint>& getPixelStoreRowByteAligment(bool packing)
+    {if (packing) return cachedPixelStorePackRowByteAligment; else return cachedPixelStoreUnPackRowByteAligment;}
+  virtual GLRegister<GLint>& getPixelStorePaddedImageWidth(bool packing)
+    {if (packing) return cachedPixelStorePackPaddedImageWidth; else return cachedPixelStoreUnPackPaddedImageWidth;}
+  virtual GLRegister<GLint>& getPixelStorePaddedImageHeight(bool packing)
+    {if (packing) return cachedPixelStorePackPaddedImageHeight; else return cachedPixelStoreUnPackPaddedImageHeight;}
+  virtual GLRegister<GLboolean>& getPixelStoreHaveLittleEndianComponentBytesOrdering(bool packing)
+    {if (packing) return cachedPixelStorePackHaveLittleEndianComponentBytesOrdering; else return cachedPixelStoreUnPackHaveLittleEndianComponentBytesOrdering;}
+  virtual GLRegister<GLboolean>& getPixelStoreHaveReversedBitsOrdering(bool packing)
+    {if (packing) return cachedPixelStorePackHaveReversedBitsOrdering; else return cachedPixelStoreUnPackHaveReversedBitsOrdering;}
+  virtual GLRegister<GLint>& getPixelStoreNumSkippedPixels(bool packing)
+    {if (packing) return cachedPixelStorePackNumSkippedPixels; else return cachedPixelStoreUnPackNumSkippedPixels;}
+  virtual GLRegister<GLint>& getPixelStoreNumSkippedRows(bool packing)
+    {if (packing) return cachedPixelStorePackNumSkippedRows; else return cachedPixelStoreUnPackNumSkippedRows;}
+  virtual GLRegister<GLint>& getPixelStoreNumSkippedImages(bool packing)
+    {if (packing) return cachedPixelStorePackNumSkippedImages; else return cachedPixelStoreUnPackNumSkippedImages;}
+  // NB: getPixelStore aliases use the cached sub registers above.
 
-  void destroy()
+  // buffer
+  virtual GLRegister<GLuint>& getActiveBufferBind(GLenum target)
   {
-    if (id)
+    switch(target)
     {
-      // TODO check binding
-      jassert(isValid()); // not a valid gl object. RAM corruption or deleted from another object or context.
-      deleteNames(id);
-      jassertglsucceed(context);
-      id = 0;
+      case GL_ARRAY_BUFFER: return cachedActiveBufferForArray;
+      case GL_COPY_READ_BUFFER: return cachedActiveBufferForCopyRead;
+      case GL_COPY_WRITE_BUFFER: return cachedActiveBufferForCopyWrite;
+      case GL_ELEMENT_ARRAY_BUFFER: return cachedActiveBufferForElementArray;
+      case GL_PIXEL_PACK_BUFFER: return cachedActiveBufferForPixelPack;
+      case GL_PIXEL_UNPACK_BUFFER: return cachedActiveBufferForPixelUnPack;
+      case GL_TEXTURE_BUFFER: return cachedActiveBufferForTexture;
+      case GL_TRANSFORM_FEEDBACK_BUFFER: return cachedActiveBufferForTransformFeedback;
+      case GL_UNIFORM_BUFFER: return cachedActiveBufferForUniform;
+      default: jassertfalse; return *reinterpret_cast<GLRegister<GLuint>* >(NULL); // check isValidBufferBindingTarget before call
     }
-    else
-      {jassertfalse;} // try to destroy an uncreated named object
   }
 
-  GLuint getId() const
-    {return id;}
+  // vertex array
+  virtual GLRegister<GLuint>& getActiveVertexArrayBind()
+    {return cachedActiveVertexArrayBind;}
 
-  GLContext& getContext() const
-    {return context;}
+  // program
+  virtual GLRegister<GLenum>& getActiveProgramBind()
+    {return cachedActiveProgramBind;}
 
-  // Warning: can produce OpenGL flushing performance penalty.
-  bool isValid() const
-    {return id && (isValidName(id) != GL_FALSE);} // glIsXXX function never produce errorFlags
+  // program pipeline
+  virtual GLRegister<GLenum>& getActiveProgramPipelineBind()
+    {return cachedActiveProgramPipelineBind;}
 
-# ifdef GLEW_MX
-  GLEWContext* glewGetContext() const
-    {return context.glewGetContext();}
-# endif // GLEW_MX
+  // named objects deletion
+  virtual void notifyTextureDeletion(GLuint textureId)
+  {
+    for (size_t i = 0; i < numTextureBindingTargets; ++i)
+      unbindDeletedName(getCachedTextureBind(i), textureId);
+    cachedActiveTextureUnit.textureDeleted(textureId);
+  }
+  virtual void notifyBufferDeletion(GLuint bufferId)
+  {
+    for (size_t i = 0; i < numBufferBindingTargets; ++i)
+      unbindDeletedName(getCachedBufferBind(i), bufferId);
+  }
+  virtual void notifyVertexArrayDeletion(GLuint vertexArrayId)
+  {
+    if (unbindDeletedName(cachedActiveVertexArrayBind, vertexArrayId))
+      cachedActiveBufferForElementArray.invalidate();
+  }
+  virtual void notifyProgramPipelineDeletion(GLuint programPipelineId)
+    {unbindDeletedName(cachedActiveProgramPipelineBind, programPipelineId);}
+  virtual void notifyProgramDeletion(GLuint programId)
+    {cachedActiveProgramBind.programDeleted(programId);} // OpenGL keep a deleted program in use
 
-protected:
-  // interface
-  virtual GLboolean isValidName(GLuint id) const = 0;
-  virtual void deleteNames(GLuint id) const = 0;
+  // subroutines limits are read once per link instead of on each loadUniformSubroutines.
+  virtual void notifyProgramLink(GLuint programId)
+  {
+    if (!hasCapability(shaderSubroutineCapability))
+      return;
+    static const GLenum shaderTypes[] = {GL_VERTEX_SHADER, GL_TESS_CONTROL_SHADER, GL_TESS_EVALUATION_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER};
+    GLint numActiveSubroutines[GLCachedProgramRegister::numStages];
+    GLint numLocations[GLCachedProgramRegister::numStages];
+    DOCGL_CLEAR_ERROR_FLAGS(*this, resourceErrorCheck);
+    for (size_t i = 0; i < GLCachedProgramRegister::numStages; ++i)
+    {
+      numActiveSubroutines[i] = numLocations[i] = 0;
+      glGetProgramStageiv(programId, shaderTypes[i], GL_ACTIVE_SUBROUTINES, &numActiveSubroutines[i]);
+      glGetProgramStageiv(programId, shaderTypes[i], GL_ACTIVE_SUBROUTINE_UNIFORM_LOCATIONS, &numLocations[i]);
+    }
+    if (DOCGL_POP_ERROR_FLAGS(*this, resourceErrorCheck).hasErrors())
+    { // limits unknown: forget the previous link entry instead of recording zeroed limits
+      jassertfalse;
+      cachedActiveProgramBind.programDeleted(programId);
+      return;
+    }
+    cachedActiveProgramBind.programLinked(programId, numActiveSubroutines, numLocations);
+  }
 
-protected:
-  GLContext& context;
-  GLuint id;
-};
+  // subroutines selections are remembered per program: redundant loads never reach OpenGL,
+  // and the selection is loaded again only after an effective program change (at next draw).
+  virtual GLErrorFlags loadUniformSubroutines(GLenum shaderType, GLsizei count, const GLuint* indices)
+  {
+    if (!hasCapability(shaderSubroutineCapability))
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // // this is not an OpenGL3.3 feature (ARB extension included in OpenGL 4.1)
+    return cachedActiveProgramBind.selectSubroutines(shaderType, count, indices);
+  }
 
-//////////////////////////////////////////////////////////////////////////////
+  // deferred values: only dirty registers are visited, in the fixed getCachedRegister order.
+  virtual GLErrorFlags flushPendingValues()
+  {
+    GLErrorFlags errorFlags;
+    for (size_t i = 0; dirtyBits && i < numCachedRegisters; ++i)
+      if (dirtyBits & (GLuint64(1) << i))
+        errorFlags.merge(getCachedRegister(i).flushPendingValue());
+    errorFlags.merge(cachedActiveProgramBind.flushSubroutines()); // once the program is the logical one
+    return errorFlags;
+  }
 
-// WARNING: ensure GLRegisterType::setValue can never fail (debug assert only)
-// WARNING: use a cached register to do not perform extra setValue if there is no changes to do.
-// WARNING: not using a cached register can produce OpenGL flush performance penalty when reading previous value.
-template <class GLScopedSetValueType>
-class GLScopedSetValue
-{
-public:
-  typedef GLScopedSetValueType GLType;
-  typedef GLRegister<GLType> GLRegisterType;
+  // Deferred mode (opt-in): draw state registers setValue only record values,
+  // net changes are sent to OpenGL at the next draw or clear (intermediate states never reach OpenGL).
+  // Binds, texture unit and pixel store are never deferred: objects edition need them immediately.
+  GLErrorFlags setDeferredMode(bool deferredMode)
+  {
+    GLCachedRegisterInterface* const drawStateRegisters[] = {
+      &cachedLineSmoothHint, &cachedPolygonSmoothHint, &cachedTextureCompressionQualityHint, &cachedFragmentShaderDerivativeAccuracyHint,
+      &cachedClearColor, &cachedClearDepth, &cachedClearStencil,
+      &cachedActiveViewport, &cachedActiveScissor, &cachedScissorTest,
+      &cachedDepthTest,
+      &cachedPointSizeProgrammable, &cachedPointSize, &cachedPointPolygonOffset,
+      &cachedLinePolygonOffset,
+      &cachedCullFace, &cachedFillPolygonOffset, &cachedPolygonOffset};
+    for (size_t i = 0; i < sizeof(drawStateRegisters) / sizeof(drawStateRegisters[0]); ++i)
+      drawStateRegisters[i]->setDeferred(deferredMode);
+    this->deferredMode = deferredMode;
+    return deferredMode ? GLErrorFlags::succeed : flushPendingValues();
+  }
 
-  GLScopedSetValue(GLRegisterType& reg, const GLType newValue)
-    : reg(reg)
+  bool isDeferredMode() const
+    {return deferredMode;}
+
+  // Consistency sweep on all cached registers.
+  // Warning: produce OpenGL flushing performance penalty, use it after foreign OpenGL calls or for debugging.
+  bool isConsistent()
   {
-    constructionState = reg.getValue(backupValue);
-    if (constructionState.hasErrors())
-      {jassertfalse; return;}
-    constructionState = reg.setValue(newValue);
-    jassert(constructionState.hasSucceed());
+    for (size_t i = 0; i < getNumCachedRegisters(); ++i)
+      if (isReadableCachedRegister(i) && !getCachedRegister(i).isConsistent())
+        return false;
+    return true;
   }
 
-  void cancelScopedValue() const
+  GLErrorFlags makeConsistent()
   {
-    if (constructionState.hasSucceed())
+    GLErrorFlags errorFlags = flushPendingValues();
+    for (size_t i = 0; i < getNumCachedRegisters(); ++i)
     {
-      bool succeed = reg.setValue(backupValue).hasSucceed();
-      jassert(succeed);
-      succeed = succeed; // avoid unused value warning on release.
+      if (isReadableCachedRegister(i))
+        errorFlags.merge(getCachedRegister(i).makeConsistent());
+      else
+        getCachedRegister(i).invalidate();
     }
+    return errorFlags;
   }
 
-  GLErrorFlags getConstructionState() const
-    {return constructionState;}
-
- ~GLScopedSetValue()
- {
-   jassertglsucceed(reg.getContext()); // ensure popping errors before scope exit to do not produce cancelScopedValue false assertion.
-   cancelScopedValue();
- }
+  // forget all cached values (next accesses reach OpenGL)
+  void invalidate()
+  {
+    for (size_t i = 0; i < getNumCachedRegisters(); ++i)
+      getCachedRegister(i).invalidate();
+  }
+
+  size_t getNumCachedRegisters() const
+    {return numCachedRegisters;}
+
+  static const char* getCachedRegisterName(size_t index)
+  {
+    static const char* const names[numCachedRegisters] = {
+      "lineSmoothHint", "polygonSmoothHint", "textureCompressionQualityHint", "fragmentShaderDerivativeAccuracyHint",
+      "clearColor", "clearDepth", "clearStencil",
+      "activeViewport", "activeScissor", "scissorTest",
+      "depthTest",
+      "pointSizeProgrammable", "pointSize", "pointPolygonOffset",
+      "linePolygonOffset",
+      "cullFace", "fillPolygonOffset", "polygonOffset",
+      "activeTextureUnit",
+      "activeTexture1d", "activeTexture2d", "activeTexture3d",
+      "activeTexture1dArray", "activeTexture2dArray", "activeTextureRectangle",
+      "activeTextureBuffer", "activeTextureCubeMap",
+      "activeTexture2dMultisample", "activeTexture2dMultisampleArray",
+      "pixelStorePackRowByteAligment", "pixelStorePackPaddedImageWidth",
+      "pixelStorePackPaddedImageHeight", "pixelStorePackHaveLittleEndianComponentBytesOrdering",
+      "pixelStorePackHaveReversedBitsOrdering", "pixelStorePackNumSkippedPixels",
+      "pixelStorePackNumSkippedRows", "pixelStorePackNumSkippedImages",
+      "pixelStoreUnPackRowByteAligment", "pixelStoreUnPackPaddedImageWidth",
+      "pixelStoreUnPackPaddedImageHeight", "pixelStoreUnPackHaveLittleEndianComponentBytesOrdering",
+      "pixelStoreUnPackHaveReversedBitsOrdering", "pixelStoreUnPackNumSkippedPixels",
+      "pixelStoreUnPackNumSkippedRows", "pixelStoreUnPackNumSkippedImages",
+      "activeVertexArrayBind",
+      "activeBufferForArray", "activeBufferForCopyRead", "activeBufferForCopyWrite",
+      "activeBufferForElementArray", "activeBufferForPixelPack", "activeBufferForPixelUnPack",
+      "activeBufferForTexture", "activeBufferForTransformFeedback", "activeBufferForUniform",
+      "activeProgramBind",
+      "activeProgramPipelineBind"};
+    jassert(index < numCachedRegisters);
+    return names[index];
+  }
+
+  // Sampled consistency audit (cheap enough to stay enabled in release builds):
+  // call auditFrame at frame boundaries, it checks the next numRegistersPerFrame readable cached registers
+  // (rotating over all of them), reports each divergence then resynchronizes the diverged register.
+  struct GLRegisterDivergence
+  {
+    enum {maxValueTextLength = 64};
+
+    const char* registerName;
+    char cachedValue[maxValueTextLength];
+    char openGLValue[maxValueTextLength];
+  };
+  typedef void (*AuditReportFunction)(const GLRegisterDivergence& divergence, void* userData);
 
-private:
-  GLErrorFlags constructionState;
-  GLRegisterType& reg;
-  GLType backupValue;
-};
+  // numRegistersPerFrame 0 disables the audit, NULL reportFunction prints divergences on stderr.
+  void setAudit(size_t numRegistersPerFrame, AuditReportFunction reportFunction = NULL, void* userData = NULL)
+  {
+    numAuditedRegistersPerFrame = std::min(numRegistersPerFrame, static_cast<size_t>(numCachedRegisters));
+    auditReportFunction = reportFunction;
+    auditUserData = userData;
+  }
 
-//////////////////////////////////////////////////////////////////////////////
+  // return the number of divergences found.
+  size_t auditFrame()
+  {
+    size_t numDivergences = 0;
+    size_t numAudited = 0;
+    for (size_t i = 0; i < numCachedRegisters && numAudited < numAuditedRegistersPerFrame; ++i)
+    {
+      const size_t index = auditCursor;
+      auditCursor = (auditCursor + 1) % numCachedRegisters;
+      if (!isReadableCachedRegister(index))
+        continue; // write only registers do not use the frame budget
+      ++numAudited;
+      GLRegisterDivergence divergence;
+      GLCachedRegisterInterface& cachedRegister = getCachedRegister(index);
+      if (cachedRegister.isConsistent(divergence.cachedValue, divergence.openGLValue, GLRegisterDivergence::maxValueTextLength))
+        continue;
+      divergence.registerName = getCachedRegisterName(index);
+      if (auditReportFunction)
+        auditReportFunction(divergence, auditUserData);
+      else
+        fprintf(stderr, "docgl: cached register %s diverged (cached %s, OpenGL %s)\n",
+          divergence.registerName, divergence.cachedValue, divergence.openGLValue);
+      cachedRegister.makeConsistent();
+      ++numDivergences;
+    }
+    return numDivergences;
+  }
 
-class GLTextureObject : public GLObject
-{
-public:
-  GLTextureObject(GLContext& context)
-    : GLObject(context), target(0) {}
+# ifdef DOCGL_INSTRUMENTATION
+  // Registers statistics of the current frame.
+  // At frame boundaries: dump them if needed, then call endFrame to reset counters.
 
-  GLenum getTarget() const
-    {return target;}
+  const GLRegisterStatistics& getCachedRegisterStatistics(size_t index)
+    {return getCachedRegister(index).getStatistics();}
 
-  // Texture properties Warning: possible OpenGL flush performance penalty.
-  GLsizei getWidth(GLint level = 0) const;
-  GLsizei getHeight(GLint level = 0) const;
-  GLsizei getDepth(GLint level = 0) const;
-  GLsizei getNumSamplesPerTexel(GLint level = 0) const; // return 0 if texture is not multisampled
-  GLint getInternalFormat(GLint level = 0) const;
-  GLsizei getNumBitsForRed(GLint level = 0) const;
-  GLsizei getNumBitsForGreen(GLint level = 0) const;
-  GLsizei getNumBitsForBlue(GLint level = 0) const;
-  GLsizei getNumBitsForAlpha(GLint level = 0) const;
-  GLsizei getNumBitsForDepth(GLint level = 0) const;
-  GLsizei getNumBitsForStencil(GLint level = 0) const;
-  GLboolean isCompressed(GLint level = 0) const;
-  GLsizei getCompressedImageSize(GLint level = 0) const;
-
-  // texture sampling parameter Warning: possible OpenGL flush performance penalty.
-  GLErrorFlags getBaseLevel(GLint& baseLevel) const;
-  GLErrorFlags getMaxLevel(GLint& maxLevel) const;
-  GLErrorFlags getCompareMode(GLenum& compareMode) const;
-  GLErrorFlags getCompareFunction(GLenum& compareFunction) const;
-  GLErrorFlags getLevelOfDetailBias(GLfloat& levelOfDetailBias) const;
-  GLErrorFlags getLevelOfDetailMax(GLfloat& levelOfDetailMax) const;
-  GLErrorFlags getLevelOfDetailMin(GLfloat& levelOfDetailMin) const;
-  GLErrorFlags getMagnificationFilter(GLenum& magnificationFilter) const;
-  GLErrorFlags getMinificationFilter(GLenum& minificationFilter) const;
-  GLErrorFlags getSwizzleRed(GLenum& swizzleRed) const;
-  GLErrorFlags getSwizzleGreen(GLenum& swizzleGreen) const;
-  GLErrorFlags getSwizzleBlue(GLenum& swizzleBlue) const;
-  GLErrorFlags getSwizzleAlpha(GLenum& swizzleAlpha) const;
-  GLErrorFlags getHorizontalWrapMode(GLenum& horizontalWrapMode) const;
-  GLErrorFlags getVerticalWrapMode(GLenum& verticalWrapMode) const;
-  GLErrorFlags getDepthWrapMode(GLenum& depthWrapMode) const;
+  // all registers sum
+  GLRegisterStatistics getFrameStatistics()
+  {
+    GLRegisterStatistics statistics;
+    for (size_t i = 0; i < numCachedRegisters; ++i)
+      statistics.merge(getCachedRegisterStatistics(i));
+    return statistics;
+  }
 
-  // texture sampling parameter modifier:
-  GLErrorFlags setBaseLevel(GLint baseLevel);
-  GLErrorFlags setMaxLevel(GLint maxLevel);
-  GLErrorFlags setCompareMode(GLenum compareMode);
-  GLErrorFlags setCompareFunction(GLenum compareFunction);
-  GLErrorFlags setLevelOfDetailBias(GLfloat levelOfDetailBias);
-  GLErrorFlags setLevelOfDetailMax(GLfloat levelOfDetailMax);
-  GLErrorFlags setLevelOfDetailMin(GLfloat levelOfDetailMin);
-  GLErrorFlags setMagnificationFilter(GLenum magnificationFilter);
-  GLErrorFlags setMinificationFilter(GLenum minificationFilter);
-  GLErrorFlags setSwizzleRed(GLenum swizzleRed);
-  GLErrorFlags setSwizzleGreen(GLenum swizzleGreen);
-  GLErrorFlags setSwizzleBlue(GLenum swizzleBlue);
-  GLErrorFlags setSwizzleAlpha(GLenum swizzleAlpha);
-  GLErrorFlags setHorizontalWrapMode(GLenum horizontalWrapMode);
-  GLErrorFlags setVerticalWrapMode(GLenum verticalWrapMode);
-  GLErrorFlags setDepthWrapMode(GLenum depthWrapMode);
+  size_t getFrameIndex() const
+    {return frameIndex;}
 
-  // Warning: possible OpenGL flush performance penalty.
-  GLErrorFlags create2D(GLint internalFormat, GLsizei	width, GLsizei height, const GLPackedImage* data)
+  void endFrame()
   {
-    // todo jassert on internalFormat
-    jassert(!id); // overwritting existing: potential memory leak
-    jassert(context.isValidTextureSize(width) && context.isValidTextureSize(height));
-    glGenTextures(1, &id);
-    jassertglsucceed(context);
-    jassert(id);
-
-    target = GL_TEXTURE_2D;
-    GLScopedSetValue<GLenum> _(context.getActiveTextureBind(target), id);
-    jassertglsucceed(context);
-    const GLenum nullDataFormat = getNULLDataFormat(internalFormat);
-    // Todo optim? cache proxy result if non proxy succeed.
-    //glTexImage2D(GL_PROXY_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_UNSIGNED_BYTE, nullDataFormat, NULL)
-    GLErrorFlags errorFlags;
-    if (data)
-    {
-      GLScopedSetValue<GLPixelStore> __(context.getPixelStore(false), data->pixelStore);
-      context.clearErrorFlags(); // clear previous error ensure next popContextErrorFlags concern glTexImage
+    for (size_t i = 0; i < numCachedRegisters; ++i)
+      getCachedRegister(i).resetStatistics();
+    ++frameIndex;
+  }
 
-      glTexImage2D(target, 0, internalFormat, width, height, 0, data->format, data->type, data->data);
-      errorFlags = context.popErrorFlags(); // pop error before scope exit
-    }
-    else
+  // one line per register: frame,register,sets,redundantSets,forwardedSets,queries,nanoseconds
+  void dumpStatisticsAsCSV(FILE* file, bool withHeader)
+  {
+    if (withHeader)
+      fprintf(file, "frame,register,sets,redundantSets,forwardedSets,queries,nanoseconds\n");
+    for (size_t i = 0; i < numCachedRegisters; ++i)
     {
-      context.clearErrorFlags(); // clear previous error ensure next popContextErrorFlags concern glTexImage
-      glTexImage2D(target, 0, internalFormat, width, height, 0, GL_UNSIGNED_BYTE, nullDataFormat, NULL);
-      errorFlags = context.popErrorFlags();
+      const GLRegisterStatistics& statistics = getCachedRegisterStatistics(i);
+      fprintf(file, "%lu,%s,%lu,%lu,%lu,%lu,%llu\n", (unsigned long)frameIndex, getCachedRegisterName(i),
+        (unsigned long)statistics.numSets, (unsigned long)statistics.numRedundantSets, (unsigned long)statistics.numForwardedSets,
+        (unsigned long)statistics.numQueries, (unsigned long long)statistics.nanoseconds);
     }
-    if (errorFlags.hasErrors())
+  }
+
+  // one JSON object per frame: {"frame":N,"registers":{"name":{...},...}}
+  void dumpStatisticsAsJSON(FILE* file)
+  {
+    fprintf(file, "{\"frame\":%lu,\"registers\":{", (unsigned long)frameIndex);
+    for (size_t i = 0; i < numCachedRegisters; ++i)
     {
-      _.cancelScopedValue(); // unbind texture id before deletion seem's to be cleaner
-      destroy();
+      const GLRegisterStatistics& statistics = getCachedRegisterStatistics(i);
+      fprintf(file, "%s\"%s\":{\"sets\":%lu,\"redundantSets\":%lu,\"forwardedSets\":%lu,\"queries\":%lu,\"nanoseconds\":%llu}",
+        i ? "," : "", getCachedRegisterName(i),
+        (unsigned long)statistics.numSets, (unsigned long)statistics.numRedundantSets, (unsigned long)statistics.numForwardedSets,
+        (unsigned long)statistics.numQueries, (unsigned long long)statistics.nanoseconds);
     }
-    return errorFlags;
+    fprintf(file, "}}\n");
   }
+# endif // DOCGL_INSTRUMENTATION
 
 protected:
-  static GLenum getNULLDataFormat(GLint internalFormat)
+  enum {numTextureBindingTargets = 10, numBufferBindingTargets = 9};
+
+  // return true if OpenGL have reverted the binding to zero
+  static bool unbindDeletedName(GLCachedRegister<GLuint>& binding, GLuint id)
   {
-    return (internalFormat == GL_DEPTH_COMPONENT ||
-            internalFormat == GL_DEPTH_COMPONENT16 ||
-            internalFormat == GL_DEPTH_COMPONENT24)
-        ? GL_DEPTH_COMPONENT : GL_RGBA;
+    binding.flushPendingValue(); // a pending restore could rebind the deleted name
+    if (!binding.isCachedValue(id))
+      return false;
+    binding.setCachedValue(0);
+    return true;
   }
 
-  static GLenum getTargetProxy(GLenum target)
+  // getCachedTextureBind index
+  static size_t getTextureBindingTargetIndex(GLenum target)
   {
-    switch (target)
+    switch(target)
     {
-    case GL_TEXTURE_2D:
-      return GL_PROXY_TEXTURE_2D;
-    case GL_TEXTURE_1D_ARRAY:
-      return GL_PROXY_TEXTURE_1D_ARRAY;
-    case GL_TEXTURE_RECTANGLE:
-      return GL_PROXY_TEXTURE_RECTANGLE;
-    case GL_TEXTURE_CUBE_MAP_POSITIVE_X:
-    case GL_TEXTURE_CUBE_MAP_NEGATIVE_X:
-    case GL_TEXTURE_CUBE_MAP_POSITIVE_Y:
-    case GL_TEXTURE_CUBE_MAP_NEGATIVE_Y:
-    case GL_TEXTURE_CUBE_MAP_POSITIVE_Z:
-    case GL_TEXTURE_CUBE_MAP_NEGATIVE_Z:
-      return GL_PROXY_TEXTURE_CUBE_MAP;
-    default: jassertfalse; return 0; // unknown texture target
+    case GL_TEXTURE_1D: return 0;
+    case GL_TEXTURE_2D: return 1;
+    case GL_TEXTURE_3D: return 2;
+    case GL_TEXTURE_1D_ARRAY: return 3;
+    case GL_TEXTURE_2D_ARRAY: return 4;
+    case GL_TEXTURE_RECTANGLE: return 5;
+    case GL_TEXTURE_BUFFER: return 6;
+    case GL_TEXTURE_CUBE_MAP: return 7;
+    case GL_TEXTURE_2D_MULTISAMPLE: return 8;
+    case GL_TEXTURE_2D_MULTISAMPLE_ARRAY: return 9;
+    default: jassertfalse; return 0; // check isValidTextureBindingTarget before call
     }
   }
 
-  static bool isValidCompareMode(GLenum compareMode)
-    {return compareMode == GL_NONE || compareMode == GL_COMPARE_REF_TO_TEXTURE;}
-
-  static bool isValidMagnificationFilter(GLenum magnificationFilter)
-    {return magnificationFilter == GL_NEAREST || magnificationFilter == GL_LINEAR;}
+  GLCachedRegister<GLuint>& getCachedTextureBind(size_t index)
+  {
+    GLCachedRegister<GLuint>* const binds[numTextureBindingTargets] = {
+      &cachedActiveTexture1d, &cachedActiveTexture2d, &cachedActiveTexture3d,
+      &cachedActiveTexture1dArray, &cachedActiveTexture2dArray, &cachedActiveTextureRectangle,
+      &cachedActiveTextureBuffer, &cachedActiveTextureCubeMap,
+      &cachedActiveTexture2dMultisample, &cachedActiveTexture2dMultisampleArray};
+    jassert(index < numTextureBindingTargets);
+    return *binds[index];
+  }
 
-  static bool isValidMinificationFilter(GLenum minificationFilter)
+  GLCachedRegister<GLuint>& getCachedBufferBind(size_t index)
   {
-    return minificationFilter == GL_NEAREST ||
+    GLCachedRegister<GLuint>* const binds[numBufferBindingTargets] = {
+      &cachedActiveBufferForArray, &cachedActiveBufferForCopyRead, &cachedActiveBufferForCopyWrite,
+      &cachedActiveBufferForElementArray, &cachedActiveBufferForPixelPack, &cachedActiveBufferForPixelUnPack,
+      &cachedActiveBufferForTexture, &cachedActiveBufferForTransformFeedback, &cachedActiveBufferForUniform};
+    jassert(index < numBufferBindingTargets);
+    return *binds[index];
+  }
+
+  // cached registers in consistency sweep and flush order (see cachedRegisters)
+  GLCachedRegisterInterface& getCachedRegister(size_t index)
+    {jassert(index < numCachedRegisters); return *cachedRegisters[index];}
+
+  // some registers could not be read back from OpenGL: they are invalidated instead of loaded.
+  bool isReadableCachedRegister(size_t index)
+  {
+    GLCachedRegisterInterface& cachedRegister = getCachedRegister(index);
+    if (&cachedRegister == &cachedActiveBufferForCopyRead ||
+        &cachedRegister == &cachedActiveBufferForCopyWrite ||
+        &cachedRegister == &cachedActiveBufferForTexture) // write only registers
+      return false;
+    if (&cachedRegister == &cachedActiveProgramPipelineBind)
+      return hasCapability(separateShaderObjectsCapability); // this is not an OpenGL3.3 feature (ARB extension included in OpenGL 4.1)
+    return true;
+  }
+
+  enum {numCachedRegisters = 57};
+
+  // hints
+  GLCachedRegister<GLenum> cachedLineSmoothHint;
+  GLCachedRegister<GLenum> cachedPolygonSmoothHint;
+  GLCachedRegister<GLenum> cachedTextureCompressionQualityHint;
+  GLCachedRegister<GLenum> cachedFragmentShaderDerivativeAccuracyHint;
+
+  // clear
+  GLCachedRegister<GLColor> cachedClearColor;
+  GLCachedRegister<GLfloat> cachedClearDepth;
+  GLCachedRegister<GLint> cachedClearStencil;
+
+  // viewport
+  GLCachedRegister<GLRegion> cachedActiveViewport;
+
+  // scissor
+  GLCachedRegister<GLRegion> cachedActiveScissor;
+  GLCachedRegister<GLboolean> cachedScissorTest;
+
+  // depth
+  GLCachedRegister<GLboolean> cachedDepthTest;
+
+  // point
+  GLCachedRegister<GLboolean> cachedPointSizeProgrammable;
+  GLCachedRegister<GLfloat> cachedPointSize;
+  GLCachedRegister<GLboolean> cachedPointPolygonOffset;
+
+  // line
+  GLCachedRegister<GLboolean> cachedLinePolygonOffset;
+
+  // polygon
+  GLCachedRegister<GLboolean> cachedCullFace;
+  GLCachedRegister<GLboolean> cachedFillPolygonOffset;
+  GLCachedRegister<GLPolygonOffset> cachedPolygonOffset;
+
+  // multitexture
+  GLCachedTextureUnitRegister cachedActiveTextureUnit;
+
+  // texture
+  GLCachedRegister<GLuint> cachedActiveTexture1d;
+  GLCachedRegister<GLuint> cachedActiveTexture2d;
+  GLCachedRegister<GLuint> cachedActiveTexture3d;
+  GLCachedRegister<GLuint> cachedActiveTexture1dArray;
+  GLCachedRegister<GLuint> cachedActiveTexture2dArray;
+  GLCachedRegister<GLuint> cachedActiveTextureRectangle;
+  GLCachedRegister<GLuint> cachedActiveTextureBuffer;
+  GLCachedRegister<GLuint> cachedActiveTextureCubeMap;
+  GLCachedRegister<GLuint> cachedActiveTexture2dMultisample;
+  GLCachedRegister<GLuint> cachedActiveTexture2dMultisampleArray;
+
+  // pixel
+  GLCachedRegister<GLint>     cachedPixelStorePackRowByteAligment;
+  GLCachedRegister<GLint>     cachedPixelStorePackPaddedImageWidth;
+  GLCachedRegister<GLint>     cachedPixelStorePackPaddedImageHeight;
+  GLCachedRegister<GLboolean> cachedPixelStorePackHaveLittleEndianComponentBytesOrdering;
+  GLCachedRegister<GLboolean> cachedPixelStorePackHaveReversedBitsOrdering;
+  GLCachedRegister<GLint>     cachedPixelStorePackNumSkippedPixels;
+  GLCachedRegister<GLint>     cachedPixelStorePackNumSkippedRows;
+  GLCachedRegister<GLint>     cachedPixelStorePackNumSkippedImages;
+  GLCachedRegister<GLint>     cachedPixelStoreUnPackRowByteAligment;
+  GLCachedRegister<GLint>     cachedPixelStoreUnPackPaddedImageWidth;
+  GLCachedRegister<GLint>     cachedPixelStoreUnPackPaddedImageHeight;
+  GLCachedRegister<GLboolean> cachedPixelStoreUnPackHaveLittleEndianComponentBytesOrdering;
+  GLCachedRegister<GLboolean> cachedPixelStoreUnPackHaveReversedBitsOrdering;
+  GLCachedRegister<GLint>     cachedPixelStoreUnPackNumSkippedPixels;
+  GLCachedRegister<GLint>     cachedPixelStoreUnPackNumSkippedRows;
+  GLCachedRegister<GLint>     cachedPixelStoreUnPackNumSkippedImages;
+
+  // buffer
+  GLCachedRegister<GLuint> cachedActiveBufferForArray;
+  GLCachedRegister<GLuint> cachedActiveBufferForCopyRead;
+  GLCachedRegister<GLuint> cachedActiveBufferForCopyWrite;
+  GLCachedRegister<GLuint> cachedActiveBufferForElementArray;
+  GLCachedRegister<GLuint> cachedActiveBufferForPixelPack;
+  GLCachedRegister<GLuint> cachedActiveBufferForPixelUnPack;
+  GLCachedRegister<GLuint> cachedActiveBufferForTexture;
+  GLCachedRegister<GLuint> cachedActiveBufferForTransformFeedback;
+  GLCachedRegister<GLuint> cachedActiveBufferForUniform;
+
+  // vertex array
+  GLCachedSelectorRegister<GLuint> cachedActiveVertexArrayBind;
+
+  // program
+  GLCachedProgramRegister cachedActiveProgramBind;
+
+  // program pipeline
+  GLCachedRegister<GLuint> cachedActiveProgramPipelineBind;
+
+  GLCachedRegisterInterface* cachedRegisters[numCachedRegisters]; // filled once by the constructor
+
+  // deferred values
+  GLuint64 dirtyBits; // one bit per getCachedRegister index
+  bool deferredMode;
+
+  // consistency audit
+  size_t auditCursor; // next getCachedRegister index to check
+  size_t numAuditedRegistersPerFrame;
+  AuditReportFunction auditReportFunction;
+  void* auditUserData;
+
+# ifdef DOCGL_INSTRUMENTATION
+  size_t frameIndex;
+# endif // DOCGL_INSTRUMENTATION
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Static dispatch register: calls are qualified with the concrete register type,
+// so they are resolved (and can be inlined) at compile time instead of going through the GLRegister vtable.
+template <class GLRegisterImplementation, typename GLRegisterValueType>
+class GLStaticRegister
+{
+public:
+  typedef GLRegisterValueType GLType;
+
+  explicit GLStaticRegister(GLRegisterImplementation& implementation)
+    : implementation(implementation) {}
+
+  GLErrorFlags setValue(const GLType& value)
+    {return implementation.GLRegisterImplementation::setValue(value);}
+  GLErrorFlags getValue(GLType& value) const
+    {return implementation.GLRegisterImplementation::getValue(value);}
+  GLErrorFlags restoreValue(const GLType& value)
+    {return implementation.GLRegisterImplementation::restoreValue(value);}
+
+  // virtual register (GLScopedSetValue...)
+  GLRegister<GLType>& getRegister() const
+    {return implementation;}
+  operator GLRegister<GLType>&() const
+    {return implementation;}
+
+private:
+  GLRegisterImplementation& implementation;
+};
+
+// GLStaticContext policies: concrete registers of a context implementation.
+struct GLDirectPolicy
+{
+  typedef GLDirectContext ContextType;
+
+  // hints
+  typedef GLStaticRegister<GLHint<GL_LINE_SMOOTH_HINT>, GLenum> LineSmoothHint;
+  static LineSmoothHint getLineSmoothHint(ContextType& context)
+    {return LineSmoothHint(context.lineSmoothHint);}
+  typedef GLStaticRegister<GLHint<GL_POLYGON_SMOOTH_HINT>, GLenum> PolygonSmoothHint;
+  static PolygonSmoothHint getPolygonSmoothHint(ContextType& context)
+    {return PolygonSmoothHint(context.polygonSmoothHint);}
+  typedef GLStaticRegister<GLHint<GL_TEXTURE_COMPRESSION_HINT>, GLenum> TextureCompressionQualityHint;
+  static TextureCompressionQualityHint getTextureCompressionQualityHint(ContextType& context)
+    {return TextureCompressionQualityHint(context.textureCompressionQualityHint);}
+  typedef GLStaticRegister<GLHint<GL_FRAGMENT_SHADER_DERIVATIVE_HINT>, GLenum> FragmentShaderDerivativeAccuracyHint;
+  static FragmentShaderDerivativeAccuracyHint getFragmentShaderDerivativeAccuracyHint(ContextType& context)
+    {return FragmentShaderDerivativeAccuracyHint(context.fragmentShaderDerivativeAccuracyHint);}
+
+  // clear
+  typedef GLStaticRegister<GLClearColor, GLColor> ClearColor;
+  static ClearColor getClearColor(ContextType& context)
+    {return ClearColor(context.clearColor);}
+  typedef GLStaticRegister<GLClearDepth, GLfloat> ClearDepth;
+  static ClearDepth getClearDepth(ContextType& context)
+    {return ClearDepth(context.clearDepth);}
+  typedef GLStaticRegister<GLClearStencil, GLint> ClearStencil;
+  static ClearStencil getClearStencil(ContextType& context)
+    {return ClearStencil(context.clearStencil);}
+
+  // viewport and scissor
+  typedef GLStaticRegister<GLActiveViewport, GLRegion> ActiveViewport;
+  static ActiveViewport getActiveViewport(ContextType& context)
+    {return ActiveViewport(context.activeViewport);}
+  typedef GLStaticRegister<GLActiveScissor, GLRegion> ActiveScissor;
+  static ActiveScissor getActiveScissor(ContextType& context)
+    {return ActiveScissor(context.activeScissor);}
+  typedef GLStaticRegister<GLBooleanRegister<GL_SCISSOR_TEST>, GLboolean> ScissorTest;
+  static ScissorTest getScissorTest(ContextType& context)
+    {return ScissorTest(context.scissorTest);}
+
+  // depth
+  typedef GLStaticRegister<GLBooleanRegister<GL_DEPTH_TEST>, GLboolean> DepthTest;
+  static DepthTest getDepthTest(ContextType& context)
+    {return DepthTest(context.depthTest);}
+
+  // points, lines and polygons
+  typedef GLStaticRegister<GLBooleanRegister<GL_PROGRAM_POINT_SIZE>, GLboolean> PointSizeProgrammable;
+  static PointSizeProgrammable getPointSizeProgrammable(ContextType& context)
+    {return PointSizeProgrammable(context.pointSizeProgrammable);}
+  typedef GLStaticRegister<GLPointSize, GLfloat> PointSize;
+  static PointSize getPointSize(ContextType& context)
+    {return PointSize(context.pointSize);}
+  typedef GLStaticRegister<GLBooleanRegister<GL_POLYGON_OFFSET_POINT>, GLboolean> PointPolygonOffset;
+  static PointPolygonOffset getPointPolygonOffset(ContextType& context)
+    {return PointPolygonOffset(context.pointPolygonOffset);}
+  typedef GLStaticRegister<GLBooleanRegister<GL_POLYGON_OFFSET_LINE>, GLboolean> LinePolygonOffset;
+  static LinePolygonOffset getLinePolygonOffset(ContextType& context)
+    {return LinePolygonOffset(context.linePolygonOffset);}
+  typedef GLStaticRegister<GLBooleanRegister<GL_CULL_FACE>, GLboolean> CullFace;
+  static CullFace getCullFace(ContextType& context)
+    {return CullFace(context.cullFace);}
+  typedef GLStaticRegister<GLBooleanRegister<GL_POLYGON_OFFSET_FILL>, GLboolean> FillPolygonOffset;
+  static FillPolygonOffset getFillPolygonOffset(ContextType& context)
+    {return FillPolygonOffset(context.fillPolygonOffset);}
+  typedef GLStaticRegister<GLActivePolygonOffset, GLPolygonOffset> PolygonOffset;
+  static PolygonOffset getPolygonOffset(ContextType& context)
+    {return PolygonOffset(context.polygonOffset);}
+
+  // binds
+  typedef GLStaticRegister<GLActiveTextureUnit, GLenum> ActiveTextureUnit;
+  static ActiveTextureUnit getActiveTextureUnit(ContextType& context)
+    {return ActiveTextureUnit(context.activeTextureUnit);}
+  typedef GLStaticRegister<GLActiveVertexArrayBind, GLuint> ActiveVertexArrayBind;
+  static ActiveVertexArrayBind getActiveVertexArrayBind(ContextType& context)
+    {return ActiveVertexArrayBind(context.activeVertexArrayBind);}
+  typedef GLStaticRegister<GLActiveProgramBind, GLuint> ActiveProgramBind;
+  static ActiveProgramBind getActiveProgramBind(ContextType& context)
+    {return ActiveProgramBind(context.activeProgramBind);}
+  typedef GLStaticRegister<GLActiveProgramPipelineBind, GLuint> ActiveProgramPipelineBind;
+  static ActiveProgramPipelineBind getActiveProgramPipelineBind(ContextType& context)
+    {return ActiveProgramPipelineBind(context.activeProgramPipelineBind);}
+};
+
+struct GLCachedPolicy
+{
+  typedef GLCachedContext ContextType;
+
+  // hints
+  typedef GLStaticRegister<GLCachedRegister<GLenum>, GLenum> LineSmoothHint;
+  static LineSmoothHint getLineSmoothHint(ContextType& context)
+    {return LineSmoothHint(context.cachedLineSmoothHint);}
+  typedef GLStaticRegister<GLCachedRegister<GLenum>, GLenum> PolygonSmoothHint;
+  static PolygonSmoothHint getPolygonSmoothHint(ContextType& context)
+    {return PolygonSmoothHint(context.cachedPolygonSmoothHint);}
+  typedef GLStaticRegister<GLCachedRegister<GLenum>, GLenum> TextureCompressionQualityHint;
+  static TextureCompressionQualityHint getTextureCompressionQualityHint(ContextType& context)
+    {return TextureCompressionQualityHint(context.cachedTextureCompressionQualityHint);}
+  typedef GLStaticRegister<GLCachedRegister<GLenum>, GLenum> FragmentShaderDerivativeAccuracyHint;
+  static FragmentShaderDerivativeAccuracyHint getFragmentShaderDerivativeAccuracyHint(ContextType& context)
+    {return FragmentShaderDerivativeAccuracyHint(context.cachedFragmentShaderDerivativeAccuracyHint);}
+
+  // clear
+  typedef GLStaticRegister<GLCachedRegister<GLColor>, GLColor> ClearColor;
+  static ClearColor getClearColor(ContextType& context)
+    {return ClearColor(context.cachedClearColor);}
+  typedef GLStaticRegister<GLCachedRegister<GLfloat>, GLfloat> ClearDepth;
+  static ClearDepth getClearDepth(ContextType& context)
+    {return ClearDepth(context.cachedClearDepth);}
+  typedef GLStaticRegister<GLCachedRegister<GLint>, GLint> ClearStencil;
+  static ClearStencil getClearStencil(ContextType& context)
+    {return ClearStencil(context.cachedClearStencil);}
+
+  // viewport and scissor
+  typedef GLStaticRegister<GLCachedRegister<GLRegion>, GLRegion> ActiveViewport;
+  static ActiveViewport getActiveViewport(ContextType& context)
+    {return ActiveViewport(context.cachedActiveViewport);}
+  typedef GLStaticRegister<GLCachedRegister<GLRegion>, GLRegion> ActiveScissor;
+  static ActiveScissor getActiveScissor(ContextType& context)
+    {return ActiveScissor(context.cachedActiveScissor);}
+  typedef GLStaticRegister<GLCachedRegister<GLboolean>, GLboolean> ScissorTest;
+  static ScissorTest getScissorTest(ContextType& context)
+    {return ScissorTest(context.cachedScissorTest);}
+
+  // depth
+  typedef GLStaticRegister<GLCachedRegister<GLboolean>, GLboolean> DepthTest;
+  static DepthTest getDepthTest(ContextType& context)
+    {return DepthTest(context.cachedDepthTest);}
+
+  // points, lines and polygons
+  typedef GLStaticRegister<GLCachedRegister<GLboolean>, GLboolean> PointSizeProgrammable;
+  static PointSizeProgrammable getPointSizeProgrammable(ContextType& context)
+    {return PointSizeProgrammable(context.cachedPointSizeProgrammable);}
+  typedef GLStaticRegister<GLCachedRegister<GLfloat>, GLfloat> PointSize;
+  static PointSize getPointSize(ContextType& context)
+    {return PointSize(context.cachedPointSize);}
+  typedef GLStaticRegister<GLCachedRegister<GLboolean>, GLboolean> PointPolygonOffset;
+  static PointPolygonOffset getPointPolygonOffset(ContextType& context)
+    {return PointPolygonOffset(context.cachedPointPolygonOffset);}
+  typedef GLStaticRegister<GLCachedRegister<GLboolean>, GLboolean> LinePolygonOffset;
+  static LinePolygonOffset getLinePolygonOffset(ContextType& context)
+    {return LinePolygonOffset(context.cachedLinePolygonOffset);}
+  typedef GLStaticRegister<GLCachedRegister<GLboolean>, GLboolean> CullFace;
+  static CullFace getCullFace(ContextType& context)
+    {return CullFace(context.cachedCullFace);}
+  typedef GLStaticRegister<GLCachedRegister<GLboolean>, GLboolean> FillPolygonOffset;
+  static FillPolygonOffset getFillPolygonOffset(ContextType& context)
+    {return FillPolygonOffset(context.cachedFillPolygonOffset);}
+  typedef GLStaticRegister<GLCachedRegister<GLPolygonOffset>, GLPolygonOffset> PolygonOffset;
+  static PolygonOffset getPolygonOffset(ContextType& context)
+    {return PolygonOffset(context.cachedPolygonOffset);}
+
+  // binds
+  typedef GLStaticRegister<GLCachedTextureUnitRegister, GLenum> ActiveTextureUnit;
+  static ActiveTextureUnit getActiveTextureUnit(ContextType& context)
+    {return ActiveTextureUnit(context.cachedActiveTextureUnit);}
+  typedef GLStaticRegister<GLCachedSelectorRegister<GLuint>, GLuint> ActiveVertexArrayBind;
+  static ActiveVertexArrayBind getActiveVertexArrayBind(ContextType& context)
+    {return ActiveVertexArrayBind(context.cachedActiveVertexArrayBind);}
+  typedef GLStaticRegister<GLCachedProgramRegister, GLuint> ActiveProgramBind;
+  static ActiveProgramBind getActiveProgramBind(ContextType& context)
+    {return ActiveProgramBind(context.cachedActiveProgramBind);}
+  typedef GLStaticRegister<GLCachedRegister<GLuint>, GLuint> ActiveProgramPipelineBind;
+  static ActiveProgramPipelineBind getActiveProgramPipelineBind(ContextType& context)
+    {return ActiveProgramPipelineBind(context.cachedActiveProgramPipelineBind);}
+};
+
+// Context with compile time register accessors: GLStaticContext<GLDirectPolicy> or GLStaticContext<GLCachedPolicy>.
+// Direct registers setValue compile down to the OpenGL call, cached registers redundant setValue to a comparison.
+// Texture, buffer and pixel store registers selected by runtime arguments stay on the virtual GLContext (getContext()).
+template <class GLPolicy>
+class GLStaticContext
+{
+public:
+  typedef typename GLPolicy::ContextType ContextType;
+
+  // virtual adapter: objects (GLTextureObject, GLProgramObject...) and generic code use the GLContext interface.
+  ContextType& getContext()
+    {return context;}
+  operator GLContext&()
+    {return context;}
+
+  GLErrorFlags initialize()
+    {return context.initialize();}
+  GLErrorFlags clear(GLbitfield mask)
+    {return context.ContextType::clear(mask);}
+  GLErrorFlags flushPendingValues()
+    {return context.ContextType::flushPendingValues();}
+
+  // hints
+  typename GLPolicy::LineSmoothHint getLineSmoothHint()
+    {return GLPolicy::getLineSmoothHint(context);}
+  typename GLPolicy::PolygonSmoothHint getPolygonSmoothHint()
+    {return GLPolicy::getPolygonSmoothHint(context);}
+  typename GLPolicy::TextureCompressionQualityHint getTextureCompressionQualityHint()
+    {return GLPolicy::getTextureCompressionQualityHint(context);}
+  typename GLPolicy::FragmentShaderDerivativeAccuracyHint getFragmentShaderDerivativeAccuracyHint()
+    {return GLPolicy::getFragmentShaderDerivativeAccuracyHint(context);}
+
+  // clear
+  typename GLPolicy::ClearColor getClearColor()
+    {return GLPolicy::getClearColor(context);}
+  typename GLPolicy::ClearDepth getClearDepth()
+    {return GLPolicy::getClearDepth(context);}
+  typename GLPolicy::ClearStencil getClearStencil()
+    {return GLPolicy::getClearStencil(context);}
+
+  // viewport and scissor
+  typename GLPolicy::ActiveViewport getActiveViewport()
+    {return GLPolicy::getActiveViewport(context);}
+  typename GLPolicy::ActiveScissor getActiveScissor()
+    {return GLPolicy::getActiveScissor(context);}
+  typename GLPolicy::ScissorTest getScissorTest()
+    {return GLPolicy::getScissorTest(context);}
+
+  // depth
+  typename GLPolicy::DepthTest getDepthTest()
+    {return GLPolicy::getDepthTest(context);}
+
+  // points, lines and polygons
+  typename GLPolicy::PointSizeProgrammable getPointSizeProgrammable()
+    {return GLPolicy::getPointSizeProgrammable(context);}
+  typename GLPolicy::PointSize getPointSize()
+    {return GLPolicy::getPointSize(context);}
+  typename GLPolicy::PointPolygonOffset getPointPolygonOffset()
+    {return GLPolicy::getPointPolygonOffset(context);}
+  typename GLPolicy::LinePolygonOffset getLinePolygonOffset()
+    {return GLPolicy::getLinePolygonOffset(context);}
+  typename GLPolicy::CullFace getCullFace()
+    {return GLPolicy::getCullFace(context);}
+  typename GLPolicy::FillPolygonOffset getFillPolygonOffset()
+    {return GLPolicy::getFillPolygonOffset(context);}
+  typename GLPolicy::PolygonOffset getPolygonOffset()
+    {return GLPolicy::getPolygonOffset(context);}
+
+  // binds
+  typename GLPolicy::ActiveTextureUnit getActiveTextureUnit()
+    {return GLPolicy::getActiveTextureUnit(context);}
+  typename GLPolicy::ActiveVertexArrayBind getActiveVertexArrayBind()
+    {return GLPolicy::getActiveVertexArrayBind(context);}
+  typename GLPolicy::ActiveProgramBind getActiveProgramBind()
+    {return GLPolicy::getActiveProgramBind(context);}
+  typename GLPolicy::ActiveProgramPipelineBind getActiveProgramPipelineBind()
+    {return GLPolicy::getActiveProgramPipelineBind(context);}
+
+private:
+  ContextType context;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+// GLContextState register accessor: a GLContext getter, with its target or packing argument if any.
+template <typename GLType>
+class GLContextRegisterAccessor
+{
+public:
+  typedef GLRegister<GLType>& (GLContext::*Getter)();
+  typedef GLRegister<GLType>& (GLContext::*TargetGetter)(GLenum);
+  typedef GLRegister<GLType>& (GLContext::*PackingGetter)(bool);
+
+  GLContextRegisterAccessor(Getter getter)
+    : getter(getter), targetGetter(NULL), packingGetter(NULL), argument(0) {}
+  GLContextRegisterAccessor(TargetGetter targetGetter, GLenum target)
+    : getter(NULL), targetGetter(targetGetter), packingGetter(NULL), argument(target) {}
+  GLContextRegisterAccessor(PackingGetter packingGetter, bool packing)
+    : getter(NULL), targetGetter(NULL), packingGetter(packingGetter), argument(packing ? 1 : 0) {}
+
+  GLRegister<GLType>& getRegister(GLContext& context) const
+  {
+    if (getter)
+      return (context.*getter)();
+    if (targetGetter)
+      return (context.*targetGetter)(argument);
+    return (context.*packingGetter)(argument != 0);
+  }
+
+private:
+  Getter getter;
+  TargetGetter targetGetter;
+  PackingGetter packingGetter;
+  GLenum argument;
+};
+
+// Snapshot of the context registers (write only buffer binds excepted).
+// On a cached context, capture read the cache: no OpenGL query while cached values are known.
+// Texture binds are the ones of the captured active texture unit.
+struct GLContextState
+{
+  enum {numTextureBindingTargets = 10, numBufferBindingTargets = 6};
+
+  // hints
+  GLenum lineSmoothHint;
+  GLenum polygonSmoothHint;
+  GLenum textureCompressionQualityHint;
+  GLenum fragmentShaderDerivativeAccuracyHint;
+
+  // clear
+  GLColor clearColor;
+  GLfloat clearDepth;
+  GLint clearStencil;
+
+  // viewport and scissor
+  GLRegion activeViewport;
+  GLRegion activeScissor;
+  GLboolean scissorTest;
+
+  // depth
+  GLboolean depthTest;
+
+  // points, lines and polygons
+  GLboolean pointSizeProgrammable;
+  GLfloat pointSize;
+  GLboolean pointPolygonOffset;
+  GLboolean linePolygonOffset;
+  GLboolean cullFace;
+  GLboolean fillPolygonOffset;
+  GLPolygonOffset polygonOffset;
+
+  // pixel store
+  GLPixelStore pixelStorePack;
+  GLPixelStore pixelStoreUnPack;
+
+  // binds (selectors before their dependents)
+  GLuint activeVertexArrayBind;
+  GLuint activeBufferBinds[numBufferBindingTargets];
+  GLenum activeTextureUnit;
+  GLuint activeTextureBinds[numTextureBindingTargets];
+  GLuint activeProgramBind;
+  GLuint activeProgramPipelineBind;
+
+  GLuint64 knownFields; // one bit per field (visit order): captured values
+
+  static const GLenum* getTextureBindingTargets()
+  {
+    static const GLenum targets[numTextureBindingTargets] = {
+      GL_TEXTURE_1D, GL_TEXTURE_2D, GL_TEXTURE_3D, GL_TEXTURE_1D_ARRAY, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_RECTANGLE,
+      GL_TEXTURE_BUFFER, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_MULTISAMPLE, GL_TEXTURE_2D_MULTISAMPLE_ARRAY};
+    return targets;
+  }
+  static const GLenum* getBufferBindingTargets() // readable ones
+  {
+    static const GLenum targets[numBufferBindingTargets] = {
+      GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_PIXEL_PACK_BUFFER, GL_PIXEL_UNPACK_BUFFER,
+      GL_TRANSFORM_FEEDBACK_BUFFER, GL_UNIFORM_BUFFER};
+    return targets;
+  }
+
+  // visit fields in apply order: visitor.visit(fieldIndex, field, otherStateField, accessor)
+  template <class GLStateVisitor>
+  static void visit(GLStateVisitor& visitor, GLContextState& state, const GLContextState& other)
+  {
+    size_t i = 0;
+    visitor.visit(i++, state.lineSmoothHint, other.lineSmoothHint, GLContextRegisterAccessor<GLenum>(&GLContext::getLineSmoothHint));
+    visitor.visit(i++, state.polygonSmoothHint, other.polygonSmoothHint, GLContextRegisterAccessor<GLenum>(&GLContext::getPolygonSmoothHint));
+    visitor.visit(i++, state.textureCompressionQualityHint, other.textureCompressionQualityHint, GLContextRegisterAccessor<GLenum>(&GLContext::getTextureCompressionQualityHint));
+    visitor.visit(i++, state.fragmentShaderDerivativeAccuracyHint, other.fragmentShaderDerivativeAccuracyHint, GLContextRegisterAccessor<GLenum>(&GLContext::getFragmentShaderDerivativeAccuracyHint));
+
+    visitor.visit(i++, state.clearColor, other.clearColor, GLContextRegisterAccessor<GLColor>(&GLContext::getClearColor));
+    visitor.visit(i++, state.clearDepth, other.clearDepth, GLContextRegisterAccessor<GLfloat>(&GLContext::getClearDepth));
+    visitor.visit(i++, state.clearStencil, other.clearStencil, GLContextRegisterAccessor<GLint>(&GLContext::getClearStencil));
+
+    visitor.visit(i++, state.activeViewport, other.activeViewport, GLContextRegisterAccessor<GLRegion>(&GLContext::getActiveViewport));
+    visitor.visit(i++, state.activeScissor, other.activeScissor, GLContextRegisterAccessor<GLRegion>(&GLContext::getActiveScissor));
+    visitor.visit(i++, state.scissorTest, other.scissorTest, GLContextRegisterAccessor<GLboolean>(&GLContext::getScissorTest));
+
+    visitor.visit(i++, state.depthTest, other.depthTest, GLContextRegisterAccessor<GLboolean>(&GLContext::getDepthTest));
+
+    visitor.visit(i++, state.pointSizeProgrammable, other.pointSizeProgrammable, GLContextRegisterAccessor<GLboolean>(&GLContext::getPointSizeProgrammable));
+    visitor.visit(i++, state.pointSize, other.pointSize, GLContextRegisterAccessor<GLfloat>(&GLContext::getPointSize));
+    visitor.visit(i++, state.pointPolygonOffset, other.pointPolygonOffset, GLContextRegisterAccessor<GLboolean>(&GLContext::getPointPolygonOffset));
+    visitor.visit(i++, state.linePolygonOffset, other.linePolygonOffset, GLContextRegisterAccessor<GLboolean>(&GLContext::getLinePolygonOffset));
+    visitor.visit(i++, state.cullFace, other.cullFace, GLContextRegisterAccessor<GLboolean>(&GLContext::getCullFace));
+    visitor.visit(i++, state.fillPolygonOffset, other.fillPolygonOffset, GLContextRegisterAccessor<GLboolean>(&GLContext::getFillPolygonOffset));
+    visitor.visit(i++, state.polygonOffset, other.polygonOffset, GLContextRegisterAccessor<GLPolygonOffset>(&GLContext::getPolygonOffset));
+
+    visitor.visit(i++, state.pixelStorePack, other.pixelStorePack, GLContextRegisterAccessor<GLPixelStore>(&GLContext::getPixelStore, true));
+    visitor.visit(i++, state.pixelStoreUnPack, other.pixelStoreUnPack, GLContextRegisterAccessor<GLPixelStore>(&GLContext::getPixelStore, false));
+
+    visitor.visit(i++, state.activeVertexArrayBind, other.activeVertexArrayBind, GLContextRegisterAccessor<GLuint>(&GLContext::getActiveVertexArrayBind));
+    for (size_t j = 0; j < numBufferBindingTargets; ++j)
+      visitor.visit(i++, state.activeBufferBinds[j], other.activeBufferBinds[j], GLContextRegisterAccessor<GLuint>(&GLContext::getActiveBufferBind, getBufferBindingTargets()[j]));
+    visitor.visit(i++, state.activeTextureUnit, other.activeTextureUnit, GLContextRegisterAccessor<GLenum>(&GLContext::getActiveTextureUnit));
+    for (size_t j = 0; j < numTextureBindingTargets; ++j)
+      visitor.visit(i++, state.activeTextureBinds[j], other.activeTextureBinds[j], GLContextRegisterAccessor<GLuint>(&GLContext::getActiveTextureBind, getTextureBindingTargets()[j]));
+    visitor.visit(i++, state.activeProgramBind, other.activeProgramBind, GLContextRegisterAccessor<GLuint>(&GLContext::getActiveProgramBind));
+    visitor.visit(i++, state.activeProgramPipelineBind, other.activeProgramPipelineBind, GLContextRegisterAccessor<GLuint>(&GLContext::getActiveProgramPipelineBind));
+    jassert(i == numFields);
+  }
+
+  enum
+  {
+    vertexArrayBindField = 20,
+    elementArrayBufferBindField = vertexArrayBindField + 2,
+    textureUnitField = vertexArrayBindField + 1 + numBufferBindingTargets,
+    programPipelineBindField = textureUnitField + 1 + numTextureBindingTargets + 1,
+    numFields
+  };
+
+  GLContextState()
+    : lineSmoothHint(0), polygonSmoothHint(0), textureCompressionQualityHint(0), fragmentShaderDerivativeAccuracyHint(0)
+    , clearDepth(0.f), clearStencil(0), scissorTest(GL_FALSE), depthTest(GL_FALSE)
+    , pointSizeProgrammable(GL_FALSE), pointSize(0.f), pointPolygonOffset(GL_FALSE), linePolygonOffset(GL_FALSE)
+    , cullFace(GL_FALSE), fillPolygonOffset(GL_FALSE)
+    , activeVertexArrayBind(0), activeTextureUnit(GL_TEXTURE0), activeProgramBind(0), activeProgramPipelineBind(0)
+    , knownFields(0)
+  {
+    for (size_t i = 0; i < numBufferBindingTargets; ++i)
+      activeBufferBinds[i] = 0;
+    for (size_t i = 0; i < numTextureBindingTargets; ++i)
+      activeTextureBinds[i] = 0;
+  }
+
+  bool isKnownField(size_t index) const
+    {return (knownFields & (GLuint64(1) << index)) != 0;}
+
+  // read all registers values (unknown fields: unreadable registers)
+  GLErrorFlags capture(GLContext& context);
+
+  // fields to set to go from state to target: known target fields only.
+  // A selector change (vertex array, texture unit) include its dependents binds.
+  static GLuint64 diff(const GLContextState& state, const GLContextState& target);
+
+  // set the known fields selected by the diff mask (all known fields by default).
+  GLErrorFlags apply(GLContext& context, GLuint64 fields = ~GLuint64(0)) const;
+};
+
+struct GLContextStateCaptureVisitor
+{
+  GLContextStateCaptureVisitor(GLContext& context, GLContextState& state)
+    : context(context), state(state) {}
+
+  template <typename GLType>
+  void visit(size_t index, GLType& field, const GLType& /*other*/, const GLContextRegisterAccessor<GLType>& accessor)
+  {
+    if (index == GLContextState::programPipelineBindField && !context.hasCapability(separateShaderObjectsCapability))
+      return;
+    if (accessor.getRegister(context).getValue(field).hasSucceed())
+      state.knownFields |= GLuint64(1) << index;
+    else
+      errorFlags.merge(GLErrorFlags::invalidOperationFlag);
+  }
+
+  GLContext& context;
+  GLContextState& state;
+  GLErrorFlags errorFlags;
+};
+
+struct GLContextStateDiffVisitor
+{
+  GLContextStateDiffVisitor(const GLContextState& state, const GLContextState& target)
+    : state(state), target(target), fields(0) {}
+
+  template <typename GLType>
+  void visit(size_t index, const GLType& field, const GLType& targetField, const GLContextRegisterAccessor<GLType>& /*accessor*/)
+  {
+    if (target.isKnownField(index) && (!state.isKnownField(index) || !(field == targetField)))
+      fields |= GLuint64(1) << index;
+  }
+
+  const GLContextState& state;
+  const GLContextState& target;
+  GLuint64 fields;
+};
+
+struct GLContextStateApplyVisitor
+{
+  GLContextStateApplyVisitor(GLContext& context, const GLContextState& state, GLuint64 fields)
+    : context(context), state(state), fields(fields) {}
+
+  template <typename GLType>
+  void visit(size_t index, const GLType& field, const GLType& /*other*/, const GLContextRegisterAccessor<GLType>& accessor)
+  {
+    const GLuint64 bit = GLuint64(1) << index;
+    if ((fields & bit) && (state.knownFields & bit))
+      errorFlags.merge(accessor.getRegister(context).setValue(field));
+  }
+
+  GLContext& context;
+  const GLContextState& state;
+  GLuint64 fields;
+  GLErrorFlags errorFlags;
+};
+
+GLErrorFlags GLContextState::capture(GLContext& context)
+{
+  knownFields = 0;
+  GLContextStateCaptureVisitor visitor(context, *this);
+  visit(visitor, *this, *this);
+  return visitor.errorFlags;
+}
+
+GLuint64 GLContextState::diff(const GLContextState& state, const GLContextState& target)
+{
+  GLContextStateDiffVisitor visitor(state, target);
+  visit(visitor, const_cast<GLContextState&>(state), target);
+
+  const GLuint64 knownTargetFields = target.knownFields;
+  if (visitor.fields & (GLuint64(1) << vertexArrayBindField))
+    visitor.fields |= knownTargetFields & (GLuint64(1) << elementArrayBufferBindField);
+  if (visitor.fields & (GLuint64(1) << textureUnitField))
+    for (size_t i = 0; i < numTextureBindingTargets; ++i)
+      visitor.fields |= knownTargetFields & (GLuint64(1) << (textureUnitField + 1 + i));
+  return visitor.fields;
+}
+
+GLErrorFlags GLContextState::apply(GLContext& context, GLuint64 fields) const
+{
+  GLContextStateApplyVisitor visitor(context, *this, fields);
+  visit(visitor, const_cast<GLContextState&>(*this), *this);
+  return visitor.errorFlags;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// driver debug message (KHR_debug / ARB_debug_output callback)
+struct GLDebugMessage
+{
+  enum {maxTextLength = 256};
+
+  bool isError() const
+    {return type == GL_DEBUG_TYPE_ERROR;}
+  bool isPerformanceWarning() const
+    {return type == GL_DEBUG_TYPE_PERFORMANCE;}
+
+  // error messages as GLErrorFlags: ids equal to an OpenGL error code are mapped to their flag,
+  // other ids are driver specific and reported as unknown error code.
+  GLErrorFlags getErrorFlags() const
+  {
+    if (!isError())
+      return GLErrorFlags::succeed;
+    switch (id)
+    {
+    case GL_INVALID_ENUM: return GLErrorFlags::invalidEnumFlag;
+    case GL_INVALID_VALUE: return GLErrorFlags::invalidValueFlag;
+    case GL_INVALID_OPERATION: return GLErrorFlags::invalidOperationFlag;
+    case GL_OUT_OF_MEMORY: return GLErrorFlags::outOfVideoMemoryFlag;
+    case GL_INVALID_FRAMEBUFFER_OPERATION: return GLErrorFlags::invalidFrameBufferOperationFlag;
+    default:
+      {
+        GLErrorFlags errorFlags;
+        errorFlags.setUnknownErrorCode(id != GL_NO_ERROR ? id : GL_DEBUG_TYPE_ERROR); // id 0 would read as succeed
+        return errorFlags;
+      }
+    }
+  }
+
+  static const char* getSourceName(GLenum source)
+  {
+    switch (source)
+    {
+    case GL_DEBUG_SOURCE_API: return "api";
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "windowSystem";
+    case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shaderCompiler";
+    case GL_DEBUG_SOURCE_THIRD_PARTY: return "thirdParty";
+    case GL_DEBUG_SOURCE_APPLICATION: return "application";
+    default: return "other";
+    }
+  }
+
+  static const char* getTypeName(GLenum type)
+  {
+    switch (type)
+    {
+    case GL_DEBUG_TYPE_ERROR: return "error";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecatedBehavior";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefinedBehavior";
+    case GL_DEBUG_TYPE_PORTABILITY: return "portability";
+    case GL_DEBUG_TYPE_PERFORMANCE: return "performance";
+    default: return "other";
+    }
+  }
+
+  static const char* getSeverityName(GLenum severity)
+  {
+    switch (severity)
+    {
+    case GL_DEBUG_SEVERITY_HIGH: return "high";
+    case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+    case GL_DEBUG_SEVERITY_LOW: return "low";
+    default: return "notification";
+    }
+  }
+
+  GLenum source;
+  GLenum type;
+  GLuint id;
+  GLenum severity;
+  char text[maxTextLength]; // truncated, zero terminated
+};
+
+// Fixed size lock free ring (bounded multi producers queue, one sequence number per slot):
+// asynchronous debug output can call the callback from driver threads, the context thread drains it.
+class GLDebugMessageRing
+{
+public:
+  enum {capacity = 256}; // power of two
+
+  GLDebugMessageRing()
+    : enqueuePosition(0), dequeuePosition(0), numDroppedMessages(0)
+  {
+    for (size_t i = 0; i < capacity; ++i)
+      slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  // any thread: return false (and count it) when the ring is full.
+  bool push(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* text)
+  {
+    size_t position = enqueuePosition.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;)
+    {
+      slot = &slots[position & (capacity - 1)];
+      const std::ptrdiff_t difference = (std::ptrdiff_t)(slot->sequence.load(std::memory_order_acquire) - position);
+      if (difference == 0)
+      {
+        if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (difference < 0) // slot not drained yet
+      {
+        numDroppedMessages.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      else
+        position = enqueuePosition.load(std::memory_order_relaxed);
+    }
+    GLDebugMessage& message = slot->message;
+    message.source = source;
+    message.type = type;
+    message.id = id;
+    message.severity = severity;
+    const size_t textLength = length < 0 ? strlen(text) : (size_t)length; // negative length: zero terminated
+    const size_t copiedLength = textLength < GLDebugMessage::maxTextLength ? textLength : GLDebugMessage::maxTextLength - 1;
+    memcpy(message.text, text, copiedLength);
+    message.text[copiedLength] = 0;
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  // context thread only: return false when the ring is empty.
+  bool pop(GLDebugMessage& message)
+  {
+    Slot& slot = slots[dequeuePosition & (capacity - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition + 1)
+      return false;
+    message = slot.message;
+    slot.sequence.store(dequeuePosition + capacity, std::memory_order_release);
+    ++dequeuePosition;
+    return true;
+  }
+
+  // messages lost because the ring was full (reset by the caller)
+  size_t popNumDroppedMessages()
+    {return numDroppedMessages.exchange(0, std::memory_order_relaxed);}
+
+private:
+  struct Slot
+  {
+    std::atomic<size_t> sequence;
+    GLDebugMessage message;
+  };
+
+  Slot slots[capacity];
+  std::atomic<size_t> enqueuePosition;
+  size_t dequeuePosition;
+  std::atomic<size_t> numDroppedMessages;
+};
+
+// Driver debug output: install the callback after context initialize, drain messages once per frame.
+// Filtering is done by the driver (glDebugMessageControl): disabled messages never reach the ring.
+class GLDebugOutput
+{
+public:
+  GLDebugOutput(GLContext& context)
+    : context(context), installed(false), numDroppedMessages(0) {}
+
+  ~GLDebugOutput()
+    {jassert(!installed);} // call uninstall before destruction: the driver keep a pointer on the ring.
+
+  // synchronous: messages are generated in the faulty call (attributable, slower), otherwise by driver threads.
+  // Return invalidOperationFlag without assertion if neither KHR_debug nor ARB_debug_output is available.
+  GLErrorFlags install(bool synchronous = false)
+  {
+    jassert(!installed);
+    DOCGL_CLEAR_ERROR_FLAGS(context, resourceErrorCheck);
+    if (context.hasCapability(debugOutputCapability))
+    {
+      glEnable(GL_DEBUG_OUTPUT);
+      glDebugMessageCallback(&debugMessageCallback, &ring);
+    }
+    else if (context.hasCapability(debugOutputARBCapability))
+      glDebugMessageCallbackARB(&debugMessageCallback, &ring);
+    else
+      return GLErrorFlags::invalidOperationFlag;
+    if (synchronous)
+      glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    else
+      glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    installed = true;
+    return DOCGL_POP_ERROR_FLAGS(context, resourceErrorCheck);
+  }
+
+  void uninstall()
+  {
+    if (!installed)
+      return;
+    if (context.hasCapability(debugOutputCapability))
+    {
+      glDebugMessageCallback(NULL, NULL);
+      glDisable(GL_DEBUG_OUTPUT);
+    }
+    else
+      glDebugMessageCallbackARB(NULL, NULL);
+    installed = false;
+  }
+
+  bool isInstalled() const
+    {return installed;}
+
+  // driver side filters: GL_DONT_CARE matches all sources, types or severities.
+  GLErrorFlags setSeverityEnabled(GLenum severity, bool enabled)
+    {return setMessagesEnabled(GL_DONT_CARE, GL_DONT_CARE, severity, 0, NULL, enabled);}
+  GLErrorFlags setMessageEnabled(GLenum source, GLenum type, GLuint id, bool enabled) // source and type can't be GL_DONT_CARE
+    {return setMessagesEnabled(source, type, GL_DONT_CARE, 1, &id, enabled);}
+
+  // Once per frame on the context thread: handler receive each message (NULL: printed on stderr),
+  // return error messages merged as GLErrorFlags (like popErrorFlags).
+  typedef void (*MessageHandler)(const GLDebugMessage& message, void* userData);
+  GLErrorFlags drainMessages(MessageHandler handler = NULL, void* userData = NULL)
+  {
+    GLErrorFlags errorFlags;
+    GLDebugMessage message;
+    while (ring.pop(message))
+    {
+      if (handler)
+        handler(message, userData);
+      else
+        fprintf(stderr, "docgl: %s %s %s message %u: %s\n", GLDebugMessage::getSeverityName(message.severity),
+          GLDebugMessage::getSourceName(message.source), GLDebugMessage::getTypeName(message.type), message.id, message.text);
+      const GLErrorFlags messageErrorFlags = message.getErrorFlags();
+      if (!messageErrorFlags.hasUnkownErrorCode() || !errorFlags.hasUnkownErrorCode()) // keep the first unknown code
+        errorFlags.merge(messageErrorFlags);
+    }
+    const size_t numDroppedMessages = ring.popNumDroppedMessages();
+    if (numDroppedMessages && !handler)
+      fprintf(stderr, "docgl: %lu debug messages dropped (ring full)\n", (unsigned long)numDroppedMessages);
+    this->numDroppedMessages += numDroppedMessages;
+    return errorFlags;
+  }
+
+  // total messages lost because drainMessages was not called often enough
+  size_t getNumDroppedMessages() const
+    {return numDroppedMessages;}
+
+# ifdef GLEW_MX
+  GLEWContext* glewGetContext() const
+    {return context.glewGetContext();}
+# endif // GLEW_MX
+
+private:
+  // non copyable: the driver keep a pointer on the ring
+  GLDebugOutput(const GLDebugOutput& other);
+  GLDebugOutput& operator =(const GLDebugOutput& other);
+
+  static void GLAPIENTRY debugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam)
+    {static_cast<GLDebugMessageRing*>(const_cast<void*>(userParam))->push(source, type, id, severity, length, message);}
+
+  GLErrorFlags setMessagesEnabled(GLenum source, GLenum type, GLenum severity, GLsizei count, const GLuint* ids, bool enabled)
+  {
+    if (!installed)
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
+    if (context.hasCapability(debugOutputCapability))
+      glDebugMessageControl(source, type, severity, count, ids, enabled ? GL_TRUE : GL_FALSE);
+    else
+      glDebugMessageControlARB(source, type, severity, count, ids, enabled ? GL_TRUE : GL_FALSE);
+    jassertglsucceed(context);
+    return GLErrorFlags::succeed;
+  }
+
+  GLContext& context;
+  GLDebugMessageRing ring;
+  bool installed;
+  size_t numDroppedMessages;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+struct GLPackedImage
+{
+  GLPackedImage()
+    : data(0) {}
+
+  // manual initializing
+  void set(GLenum format, GLenum type, GLvoid* data)
+  {
+    this->format = format;
+    this->type = type;
+    this->data = data;
+    jassert(isValid());
+  }
+
+  // floating initializing helper
+  void setR(GLfloat* data)
+    {set(GL_RED, GL_FLOAT, data);}
+  void setRG(GLfloat* data)
+    {set(GL_RG, GL_FLOAT, data);}
+  void setRGB(GLfloat* data)
+    {set(GL_RGB, GL_FLOAT, data);}
+  void setRGBA(GLfloat* data)
+    {set(GL_RGBA, GL_FLOAT, data);}
+  void setBGRA(GLfloat* data)
+    {set(GL_BGRA, GL_FLOAT, data);}
+
+  // unsigned byte initializing helper
+  void setR(GLubyte* data)
+    {set(GL_RED, GL_UNSIGNED_BYTE, data);}
+  void setRG(GLubyte* data)
+    {set(GL_RG, GL_UNSIGNED_BYTE, data);}
+  void setRGB(GLubyte* data)
+    {set(GL_RGB, GL_UNSIGNED_BYTE, data);}
+  void setRGBA(GLubyte* data)
+    {set(GL_RGBA, GL_UNSIGNED_BYTE, data);}
+  void setBGRA(GLubyte* data)
+    {set(GL_BGRA, GL_UNSIGNED_BYTE, data);}
+
+  // Validation
+  static bool isValidFormat(GLenum format) // extend if needed
+    {return format == GL_RED || format == GL_RG || format == GL_RGB || format == GL_RGBA || format == GL_BGRA;}
+  static bool isValidType(GLenum type) // extend if needed
+    {return type == GL_FLOAT || type == GL_UNSIGNED_BYTE;}
+  bool isValid() const
+  {
+    bool valid = pixelStore.isValid();
+    if (!valid)
+      {jassertfalse; return false;}
+    valid = isValidFormat(format);
+    if (!valid)
+      {jassertfalse; return false;}
+    valid = isValidType(type);
+    if (!valid)
+      {jassertfalse; return false;}
+    valid = data != NULL;
+    if (!valid)
+      {jassertfalse; return false;}
+    return valid;
+  }
+
+  // return component count or zero on error
+  static size_t getNumComponents(GLenum format)
+  {
+    switch (format)
+    {
+    case GL_RED:
+      return 1;
+    case GL_RG:
+      return 2;
+    case GL_RGB:
+      return 3;
+    case GL_RGBA:
+    case GL_BGRA:
+      return 4;
+    default:
+      jassertfalse; // unknown or deprecated format: extend if needed.
+      return 0;
+    }
+  }
+  size_t getNumComponents() const
+    {return getNumComponents(format);}
+
+  // return pixel size in byte or zero on error
+  static size_t getPixelSize(GLenum format, GLenum type)
+  {
+    const size_t numComponent = getNumComponents(format);
+    switch (type)
+    {
+    case GL_FLOAT: return numComponent * sizeof(GLfloat);
+    case GL_UNSIGNED_BYTE: return numComponent * sizeof(GLubyte);
+    default:
+      jassertfalse; // unknown or deprecated type: extend if needed.
+      return 0;
+    }
+  }
+  size_t getPixelSize() const
+    {return getPixelSize(format, type);}
+
+  GLPixelStore pixelStore;
+  GLenum  format;
+  GLenum  type;
+  GLvoid* data;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+class GLObject
+{
+public:
+  GLObject(GLContext& context)
+    : context(context), id(0) {}
+
+  virtual ~GLObject()
+  {
+    jassert(id == 0) // VRAM leak? Call destroy() or setId(0) on your object before destruction.
+    // TODO check binding
+  }
+
+  // Construct custom object (check isValid after a non-zero set)
+  // To discard destructor assert when object is used as a 'reference', unlink object from openGL named Object with setId(0)
+  void setId(GLuint id)
+    {this->id = id;}
+
+  void destroy()
+  {
+    if (id)
+    {
+      // TODO check binding
+      jassert(isValid()); // not a valid gl object. RAM corruption or deleted from another object or context.
+      deleteNames(id);
+      jassertglsucceed(context);
+      id = 0;
+    }
+    else
+      {jassertfalse;} // try to destroy an uncreated named object
+  }
+
+  GLuint getId() const
+    {return id;}
+
+  GLContext& getContext() const
+    {return context;}
+
+  // Warning: can produce OpenGL flushing performance penalty.
+  bool isValid() const
+    {return id && (isValidName(id) != GL_FALSE);} // glIsXXX function never produce errorFlags
+
+# ifdef GLEW_MX
+  GLEWContext* glewGetContext() const
+    {return context.glewGetContext();}
+# endif // GLEW_MX
+
+protected:
+  // interface
+  virtual GLboolean isValidName(GLuint id) const = 0;
+  virtual void deleteNames(GLuint id) const = 0;
+
+protected:
+  GLContext& context;
+  GLuint id;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+// WARNING: ensure GLRegisterType::setValue can never fail (debug assert only)
+// WARNING: use a cached register to do not perform extra setValue if there is no changes to do.
+// WARNING: not using a cached register can produce OpenGL flush performance penalty when reading previous value.
+// On cached registers, saving is free and restoring is deferred until the context flushPendingValues (draw, clear...)
+// or discarded when the next scoped value is the one OpenGL still have.
+template <class GLScopedSetValueType>
+class GLScopedSetValue
+{
+public:
+  typedef GLScopedSetValueType GLType;
+  typedef GLRegister<GLType> GLRegisterType;
+
+  GLScopedSetValue(GLRegisterType& reg, const GLType newValue)
+    : reg(reg)
+  {
+    constructionState = reg.getValue(backupValue);
+    if (constructionState.hasErrors())
+      {jassertfalse; return;}
+    constructionState = reg.setValue(newValue);
+    jassert(constructionState.hasSucceed());
+  }
+
+  void cancelScopedValue() const
+  {
+    if (constructionState.hasSucceed())
+    {
+      bool succeed = reg.restoreValue(backupValue).hasSucceed();
+      jassert(succeed);
+      succeed = succeed; // avoid unused value warning on release.
+    }
+  }
+
+  GLErrorFlags getConstructionState() const
+    {return constructionState;}
+
+ ~GLScopedSetValue()
+ {
+   jassertglsucceed(reg.getContext()); // ensure popping errors before scope exit to do not produce cancelScopedValue false assertion.
+   cancelScopedValue();
+ }
+
+private:
+  GLErrorFlags constructionState;
+  GLRegisterType& reg;
+  GLType backupValue;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+// texture sampling parameters block (initialized with OpenGL default values)
+struct GLTextureSamplingParameters
+{
+  GLTextureSamplingParameters(GLenum target = GL_TEXTURE_2D)
+    : baseLevel(0), maxLevel(1000), compareMode(GL_NONE), compareFunction(GL_LEQUAL)
+    , levelOfDetailBias(0.f), levelOfDetailMax(1000.f), levelOfDetailMin(-1000.f)
+    , magnificationFilter(GL_LINEAR), minificationFilter(target == GL_TEXTURE_RECTANGLE ? GL_LINEAR : GL_NEAREST_MIPMAP_LINEAR)
+    , swizzleRed(GL_RED), swizzleGreen(GL_GREEN), swizzleBlue(GL_BLUE), swizzleAlpha(GL_ALPHA)
+    , horizontalWrapMode(target == GL_TEXTURE_RECTANGLE ? GL_CLAMP_TO_EDGE : GL_REPEAT)
+    , verticalWrapMode(horizontalWrapMode), depthWrapMode(horizontalWrapMode)
+    {}
+
+  GLint baseLevel;
+  GLint maxLevel;
+  GLenum compareMode;
+  GLenum compareFunction;
+  GLfloat levelOfDetailBias;
+  GLfloat levelOfDetailMax;
+  GLfloat levelOfDetailMin;
+  GLenum magnificationFilter;
+  GLenum minificationFilter;
+  GLenum swizzleRed;
+  GLenum swizzleGreen;
+  GLenum swizzleBlue;
+  GLenum swizzleAlpha;
+  GLenum horizontalWrapMode;
+  GLenum verticalWrapMode;
+  GLenum depthWrapMode;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+// texture level image properties (recorded at image specification)
+struct GLTextureLevelProperties
+{
+  GLTextureLevelProperties()
+    : width(0), height(0), depth(0), numSamplesPerTexel(0), internalFormat(0)
+    , numBitsForRed(0), numBitsForGreen(0), numBitsForBlue(0), numBitsForAlpha(0), numBitsForDepth(0), numBitsForStencil(0)
+    , compressed(GL_FALSE), compressedImageSize(0), described(true) {}
+
+  // components sizes are exact for sized internal formats.
+  // Unsized, compressed and unknown formats are not described (driver choice, compressed image size): refresh them.
+  GLTextureLevelProperties(GLint internalFormat, GLsizei width, GLsizei height, GLsizei depth)
+    : width(width), height(height), depth(depth), numSamplesPerTexel(0), internalFormat(internalFormat)
+    , numBitsForRed(0), numBitsForGreen(0), numBitsForBlue(0), numBitsForAlpha(0), numBitsForDepth(0), numBitsForStencil(0)
+    , compressed(isCompressedFormat(internalFormat) ? GL_TRUE : GL_FALSE), compressedImageSize(0), described(true)
+  {
+    switch (internalFormat)
+    {
+    case GL_R8: setNumBitsForColor(8, 0, 0, 0); break;
+    case GL_RG8: setNumBitsForColor(8, 8, 0, 0); break;
+    case GL_RGB8: case GL_SRGB8: setNumBitsForColor(8, 8, 8, 0); break;
+    case GL_RGBA8: case GL_SRGB8_ALPHA8: setNumBitsForColor(8, 8, 8, 8); break;
+    case GL_R16: case GL_R16F: setNumBitsForColor(16, 0, 0, 0); break;
+    case GL_RG16: case GL_RG16F: setNumBitsForColor(16, 16, 0, 0); break;
+    case GL_RGB16: case GL_RGB16F: setNumBitsForColor(16, 16, 16, 0); break;
+    case GL_RGBA16: case GL_RGBA16F: setNumBitsForColor(16, 16, 16, 16); break;
+    case GL_R32F: setNumBitsForColor(32, 0, 0, 0); break;
+    case GL_RG32F: setNumBitsForColor(32, 32, 0, 0); break;
+    case GL_RGB32F: setNumBitsForColor(32, 32, 32, 0); break;
+    case GL_RGBA32F: setNumBitsForColor(32, 32, 32, 32); break;
+    case GL_RGBA4: setNumBitsForColor(4, 4, 4, 4); break;
+    case GL_RGB5_A1: setNumBitsForColor(5, 5, 5, 1); break;
+    case GL_RGB10_A2: setNumBitsForColor(10, 10, 10, 2); break;
+    case GL_DEPTH_COMPONENT16: numBitsForDepth = 16; break;
+    case GL_DEPTH_COMPONENT24: numBitsForDepth = 24; break;
+    case GL_DEPTH_COMPONENT32: case GL_DEPTH_COMPONENT32F: numBitsForDepth = 32; break;
+    case GL_DEPTH24_STENCIL8: numBitsForDepth = 24; numBitsForStencil = 8; break;
+    case GL_DEPTH32F_STENCIL8: numBitsForDepth = 32; numBitsForStencil = 8; break;
+    default: described = false; break; // unsized, compressed or unknown format: use refresh to get components sizes.
+    }
+  }
+
+  static bool isCompressedFormat(GLint internalFormat)
+  {
+    switch (internalFormat)
+    {
+    case GL_COMPRESSED_RED: case GL_COMPRESSED_RG: case GL_COMPRESSED_RGB: case GL_COMPRESSED_RGBA:
+    case GL_COMPRESSED_SRGB: case GL_COMPRESSED_SRGB_ALPHA:
+    case GL_COMPRESSED_RED_RGTC1: case GL_COMPRESSED_SIGNED_RED_RGTC1:
+    case GL_COMPRESSED_RG_RGTC2: case GL_COMPRESSED_SIGNED_RG_RGTC2:
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT: case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_RGBA_BPTC_UNORM: case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+    case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT: case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+    case GL_COMPRESSED_RGB8_ETC2: case GL_COMPRESSED_SRGB8_ETC2:
+    case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2: case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+    case GL_COMPRESSED_RGBA8_ETC2_EAC: case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+    case GL_COMPRESSED_R11_EAC: case GL_COMPRESSED_SIGNED_R11_EAC:
+    case GL_COMPRESSED_RG11_EAC: case GL_COMPRESSED_SIGNED_RG11_EAC:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  void setNumBitsForColor(GLsizei red, GLsizei green, GLsizei blue, GLsizei alpha)
+    {numBitsForRed = red; numBitsForGreen = green; numBitsForBlue = blue; numBitsForAlpha = alpha;}
+
+  GLsizei width;
+  GLsizei height;
+  GLsizei depth;
+  GLsizei numSamplesPerTexel; // 0 if texture is not multisampled
+  GLint internalFormat;
+  GLsizei numBitsForRed;
+  GLsizei numBitsForGreen;
+  GLsizei numBitsForBlue;
+  GLsizei numBitsForAlpha;
+  GLsizei numBitsForDepth;
+  GLsizei numBitsForStencil;
+  GLboolean compressed;
+  GLsizei compressedImageSize;
+  bool described; // false: the values above are not all known from the internal format (see refresh)
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+class GLTextureObject : public GLObject
+{
+public:
+  GLTextureObject(GLContext& context)
+    : GLObject(context), target(0) {}
+
+  GLenum getTarget() const
+    {return target;}
+
+  // Texture level properties: recorded at image specification, never read from OpenGL (unspecified levels return 0).
+  GLsizei getWidth(GLint level = 0) const
+    {return getLevelProperties(level).width;}
+  GLsizei getHeight(GLint level = 0) const
+    {return getLevelProperties(level).height;}
+  GLsizei getDepth(GLint level = 0) const
+    {return getLevelProperties(level).depth;}
+  GLsizei getNumSamplesPerTexel(GLint level = 0) const // return 0 if texture is not multisampled
+    {return getLevelProperties(level).numSamplesPerTexel;}
+  GLint getInternalFormat(GLint level = 0) const
+    {return getLevelProperties(level).internalFormat;}
+  GLsizei getNumBitsForRed(GLint level = 0) const
+    {return getLevelProperties(level).numBitsForRed;}
+  GLsizei getNumBitsForGreen(GLint level = 0) const
+    {return getLevelProperties(level).numBitsForGreen;}
+  GLsizei getNumBitsForBlue(GLint level = 0) const
+    {return getLevelProperties(level).numBitsForBlue;}
+  GLsizei getNumBitsForAlpha(GLint level = 0) const
+    {return getLevelProperties(level).numBitsForAlpha;}
+  GLsizei getNumBitsForDepth(GLint level = 0) const
+    {return getLevelProperties(level).numBitsForDepth;}
+  GLsizei getNumBitsForStencil(GLint level = 0) const
+    {return getLevelProperties(level).numBitsForStencil;}
+  GLboolean isCompressed(GLint level = 0) const
+    {return getLevelProperties(level).compressed;}
+  GLsizei getCompressedImageSize(GLint level = 0) const
+    {return getLevelProperties(level).compressedImageSize;}
+
+  // false: unsized, compressed or unknown internal format, components sizes are 0 until refreshLevelProperties.
+  bool isLevelDescribed(GLint level = 0) const
+    {return getLevelProperties(level).described;}
+
+  const GLTextureLevelProperties& getLevelProperties(GLint level = 0) const
+  {
+    jassert(level >= 0);
+    static const GLTextureLevelProperties unspecifiedLevel;
+    return (level >= 0 && static_cast<size_t>(level) < levelsProperties.size()) ? levelsProperties[level] : unspecifiedLevel;
+  }
+
+  // reload level properties from OpenGL (after foreign OpenGL calls, setId on a custom object or to get driver choices).
+  // Warning: possible OpenGL flush performance penalty.
+  GLErrorFlags refreshLevelProperties(GLint level = 0);
+
+  // texture sampling parameter: read from the object parameters block, never from OpenGL.
+  GLErrorFlags getBaseLevel(GLint& baseLevel) const;
+  GLErrorFlags getMaxLevel(GLint& maxLevel) const;
+  GLErrorFlags getCompareMode(GLenum& compareMode) const;
+  GLErrorFlags getCompareFunction(GLenum& compareFunction) const;
+  GLErrorFlags getLevelOfDetailBias(GLfloat& levelOfDetailBias) const;
+  GLErrorFlags getLevelOfDetailMax(GLfloat& levelOfDetailMax) const;
+  GLErrorFlags getLevelOfDetailMin(GLfloat& levelOfDetailMin) const;
+  GLErrorFlags getMagnificationFilter(GLenum& magnificationFilter) const;
+  GLErrorFlags getMinificationFilter(GLenum& minificationFilter) const;
+  GLErrorFlags getSwizzleRed(GLenum& swizzleRed) const;
+  GLErrorFlags getSwizzleGreen(GLenum& swizzleGreen) const;
+  GLErrorFlags getSwizzleBlue(GLenum& swizzleBlue) const;
+  GLErrorFlags getSwizzleAlpha(GLenum& swizzleAlpha) const;
+  GLErrorFlags getHorizontalWrapMode(GLenum& horizontalWrapMode) const;
+  GLErrorFlags getVerticalWrapMode(GLenum& verticalWrapMode) const;
+  GLErrorFlags getDepthWrapMode(GLenum& depthWrapMode) const;
+
+  // texture sampling parameter modifier: unchanged values never reach OpenGL.
+  GLErrorFlags setBaseLevel(GLint baseLevel);
+  GLErrorFlags setMaxLevel(GLint maxLevel);
+  GLErrorFlags setCompareMode(GLenum compareMode);
+  GLErrorFlags setCompareFunction(GLenum compareFunction);
+  GLErrorFlags setLevelOfDetailBias(GLfloat levelOfDetailBias);
+  GLErrorFlags setLevelOfDetailMax(GLfloat levelOfDetailMax);
+  GLErrorFlags setLevelOfDetailMin(GLfloat levelOfDetailMin);
+  GLErrorFlags setMagnificationFilter(GLenum magnificationFilter);
+  GLErrorFlags setMinificationFilter(GLenum minificationFilter);
+  GLErrorFlags setSwizzleRed(GLenum swizzleRed);
+  GLErrorFlags setSwizzleGreen(GLenum swizzleGreen);
+  GLErrorFlags setSwizzleBlue(GLenum swizzleBlue);
+  GLErrorFlags setSwizzleAlpha(GLenum swizzleAlpha);
+  GLErrorFlags setHorizontalWrapMode(GLenum horizontalWrapMode);
+  GLErrorFlags setVerticalWrapMode(GLenum verticalWrapMode);
+  GLErrorFlags setDepthWrapMode(GLenum depthWrapMode);
+
+  // whole block access: setSamplingParameters send modified parameters with a single texture bind.
+  const GLTextureSamplingParameters& getSamplingParameters() const
+    {return samplingParameters;}
+  GLErrorFlags setSamplingParameters(const GLTextureSamplingParameters& parameters);
+
+  // reload parameters block from OpenGL (after foreign OpenGL calls or setId on a custom object).
+  // Warning: possible OpenGL flush performance penalty.
+  GLErrorFlags refreshSamplingParameters();
+
+  // Warning: possible OpenGL flush performance penalty.
+  GLErrorFlags create2D(GLint internalFormat, GLsizei	width, GLsizei height, const GLPackedImage* data)
+  {
+    // todo jassert on internalFormat
+    jassert(!id); // overwritting existing: potential memory leak
+    jassert(context.isValidTextureSize(width) && context.isValidTextureSize(height));
+    glGenTextures(1, &id);
+    jassertglsucceed(context);
+    jassert(id);
+
+    target = GL_TEXTURE_2D;
+    samplingParameters = GLTextureSamplingParameters(target);
+    levelsProperties.clear();
+    GLScopedSetValue<GLenum> _(context.getActiveTextureBind(target), id);
+    jassertglsucceed(context);
+    context.flushPendingValues(); // glTexImage depend on pixel unpack buffer bind
+    const GLenum nullDataFormat = getNULLDataFormat(internalFormat);
+    // Todo optim? cache proxy result if non proxy succeed.
+    //glTexImage2D(GL_PROXY_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_UNSIGNED_BYTE, nullDataFormat, NULL)
+    GLErrorFlags errorFlags;
+    if (data)
+    {
+      GLScopedSetValue<GLPixelStore> __(context.getPixelStore(false), data->pixelStore);
+      DOCGL_CLEAR_ERROR_FLAGS(context, resourceErrorCheck); // clear previous error ensure next popContextErrorFlags concern glTexImage
+
+      glTexImage2D(target, 0, internalFormat, width, height, 0, data->format, data->type, data->data);
+      errorFlags = DOCGL_POP_ERROR_FLAGS(context, resourceErrorCheck); // pop error before scope exit
+    }
+    else
+    {
+      DOCGL_CLEAR_ERROR_FLAGS(context, resourceErrorCheck); // clear previous error ensure next popContextErrorFlags concern glTexImage
+      glTexImage2D(target, 0, internalFormat, width, height, 0, GL_UNSIGNED_BYTE, nullDataFormat, NULL);
+      errorFlags = DOCGL_POP_ERROR_FLAGS(context, resourceErrorCheck);
+    }
+    if (errorFlags.hasErrors())
+    {
+      _.cancelScopedValue(); // unbind texture id before deletion seem's to be cleaner
+      destroy();
+    }
+    else
+      setLevelProperties(0, GLTextureLevelProperties(internalFormat, width, height, 1)); // see isLevelDescribed
+    return errorFlags;
+  }
+
+protected:
+  void setLevelProperties(GLint level, const GLTextureLevelProperties& properties)
+  {
+    jassert(level >= 0);
+    if (static_cast<size_t>(level) >= levelsProperties.size())
+      levelsProperties.resize(level + 1);
+    levelsProperties[level] = properties;
+  }
+
+  static GLenum getNULLDataFormat(GLint internalFormat)
+  {
+    return (internalFormat == GL_DEPTH_COMPONENT ||
+            internalFormat == GL_DEPTH_COMPONENT16 ||
+            internalFormat == GL_DEPTH_COMPONENT24)
+        ? GL_DEPTH_COMPONENT : GL_RGBA;
+  }
+
+  static GLenum getTargetProxy(GLenum target)
+  {
+    switch (target)
+    {
+    case GL_TEXTURE_2D:
+      return GL_PROXY_TEXTURE_2D;
+    case GL_TEXTURE_1D_ARRAY:
+      return GL_PROXY_TEXTURE_1D_ARRAY;
+    case GL_TEXTURE_RECTANGLE:
+      return GL_PROXY_TEXTURE_RECTANGLE;
+    case GL_TEXTURE_CUBE_MAP_POSITIVE_X:
+    case GL_TEXTURE_CUBE_MAP_NEGATIVE_X:
+    case GL_TEXTURE_CUBE_MAP_POSITIVE_Y:
+    case GL_TEXTURE_CUBE_MAP_NEGATIVE_Y:
+    case GL_TEXTURE_CUBE_MAP_POSITIVE_Z:
+    case GL_TEXTURE_CUBE_MAP_NEGATIVE_Z:
+      return GL_PROXY_TEXTURE_CUBE_MAP;
+    default: jassertfalse; return 0; // unknown texture target
+    }
+  }
+
+  static bool isValidCompareMode(GLenum compareMode)
+    {return compareMode == GL_NONE || compareMode == GL_COMPARE_REF_TO_TEXTURE;}
+
+  static bool isValidMagnificationFilter(GLenum magnificationFilter)
+    {return magnificationFilter == GL_NEAREST || magnificationFilter == GL_LINEAR;}
+
+  static bool isValidMinificationFilter(GLenum minificationFilter)
+  {
+    return minificationFilter == GL_NEAREST ||
       minificationFilter == GL_LINEAR ||
       minificationFilter == GL_NEAREST_MIPMAP_NEAREST ||
       minificationFilter == GL_NEAREST_MIPMAP_LINEAR ||
@@ -2288,551 +4804,1919 @@ protected:
       minificationFilter == GL_LINEAR_MIPMAP_LINEAR;
   }
 
-  static bool isValidSwizzling(GLenum swizzling)
+  static bool isValidSwizzling(GLenum swizzling)
+  {
+    return swizzling == GL_RED || swizzling == GL_GREEN ||
+      swizzling == GL_BLUE || swizzling == GL_ALPHA ||
+      swizzling == GL_ZERO || swizzling == GL_ONE;
+  }
+
+  static bool isValidWrappingMode(GLenum wrappingMode)
+    {return wrappingMode == GL_CLAMP_TO_EDGE || wrappingMode == GL_REPEAT ||
+      wrappingMode == GL_CLAMP_TO_BORDER || wrappingMode == GL_MIRRORED_REPEAT;}
+
+  static bool isValidSamplingParameters(const GLTextureSamplingParameters& parameters)
+  {
+    return parameters.baseLevel >= 0 && parameters.maxLevel >= 0 &&
+      isValidCompareMode(parameters.compareMode) &&
+      isValidMagnificationFilter(parameters.magnificationFilter) && isValidMinificationFilter(parameters.minificationFilter) &&
+      isValidSwizzling(parameters.swizzleRed) && isValidSwizzling(parameters.swizzleGreen) &&
+      isValidSwizzling(parameters.swizzleBlue) && isValidSwizzling(parameters.swizzleAlpha) &&
+      isValidWrappingMode(parameters.horizontalWrapMode) && isValidWrappingMode(parameters.verticalWrapMode) &&
+      isValidWrappingMode(parameters.depthWrapMode);
+  }
+
+  // rectangle textures have no mipmaps and cannot repeat
+  bool isValidMinificationFilterForTarget(GLenum minificationFilter) const
+    {return target != GL_TEXTURE_RECTANGLE || minificationFilter == GL_NEAREST || minificationFilter == GL_LINEAR;}
+
+  bool isValidWrappingModeForTarget(GLenum wrappingMode) const
+    {return target != GL_TEXTURE_RECTANGLE || (wrappingMode != GL_REPEAT && wrappingMode != GL_MIRRORED_REPEAT);}
+
+  bool isValidSamplingParametersForTarget(const GLTextureSamplingParameters& parameters) const
+  {
+    return isValidMinificationFilterForTarget(parameters.minificationFilter) &&
+      isValidWrappingModeForTarget(parameters.horizontalWrapMode) && isValidWrappingModeForTarget(parameters.verticalWrapMode) &&
+      isValidWrappingModeForTarget(parameters.depthWrapMode);
+  }
+
+  // send a sampling parameter to OpenGL (texture have to be bound)
+  void sendSamplingParameter(GLenum parameterName, GLint value) const
+    {glTexParameteri(target, parameterName, value);}
+  void sendSamplingParameter(GLenum parameterName, GLenum value) const
+    {glTexParameteri(target, parameterName, static_cast<GLint>(value));}
+  void sendSamplingParameter(GLenum parameterName, GLfloat value) const
+    {glTexParameterf(target, parameterName, value);}
+
+  // parameter cache: bind and send only on value change
+  template <class GLType>
+  GLErrorFlags setSamplingParameter(GLenum parameterName, GLType& cachedValue, GLType value)
+  {
+    if (value == cachedValue)
+      return GLErrorFlags::succeed;
+    if (!context.isValidTextureBindingTarget(target))
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // uncreated texture
+    GLScopedSetValue<GLuint> _(context.getActiveTextureBind(target), id);
+    sendSamplingParameter(parameterName, value);
+    jassertglsucceed(context);
+    cachedValue = value;
+    return GLErrorFlags::succeed;
+  }
+
+  // same as setSamplingParameter, texture is already bound
+  template <class GLType>
+  void updateSamplingParameter(GLenum parameterName, GLType& cachedValue, GLType value)
+  {
+    if (value == cachedValue)
+      return;
+    sendSamplingParameter(parameterName, value);
+    cachedValue = value;
+  }
+
+protected:
+  // GLObject interface
+  virtual GLboolean isValidName(GLuint id) const
+    {return glIsTexture(id);}
+  virtual void deleteNames(GLuint id) const
+    {context.notifyTextureDeletion(id); glDeleteTextures(1, &id);}
+
+private:
+  GLenum target;
+  GLTextureSamplingParameters samplingParameters;
+  std::vector<GLTextureLevelProperties> levelsProperties;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+template <class GLTextureParameterType, GLenum parameterName, GLint defaultValue = 0>
+class GLTextureParameterRegister : public GLRegister<GLTextureParameterType>
+{
+public:
+  typedef GLTextureParameterType GLType;
+
+  GLTextureParameterRegister(const GLTextureObject& textureObject)
+    : GLRegister<GLType>(textureObject.getContext()), textureObject(textureObject) {}
+
+  virtual GLType getDefaultValue() const
+    {return static_cast<GLType>(defaultValue);}
+
+  // Warning: possible OpenGL flush performance penalty.
+  virtual GLErrorFlags getValue(GLType& param) const
+  {
+    const GLenum target = textureObject.getTarget();
+    if (!GLRegister<GLType>::context.isValidTextureBindingTarget(target))
+      {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+    DOCGL_CLEAR_ERROR_FLAGS(GLRegister<GLType>::context, stateErrorCheck);
+    GLScopedSetValue<GLuint> _(GLRegister<GLType>::context.getActiveTextureBind(target), textureObject.getId());
+    GLErrorFlags errorFlags = _.getConstructionState();
+    GLint intValue = defaultValue;
+    if (errorFlags.hasSucceed())
+    {
+      glGetTexParameteriv(target, parameterName, &intValue);
+      errorFlags = DOCGL_POP_ERROR_FLAGS(GLRegister<GLType>::context, stateErrorCheck);
+      if (errorFlags.hasSucceed())
+      {
+        if (intValue < 0)
+          {jassertfalse; errorFlags = GLErrorFlags::invalidValueFlag;}
+      }
+      else
+        {jassertfalse;}
+    }
+    param = static_cast<GLType>(intValue);
+    return errorFlags;
+  }
+
+  virtual GLErrorFlags setValue(const GLType& param)
+  {
+    // TODO check
+    //if (!context.isValidTextureParameter(parameterName, param))
+    //  {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+    if (param < 0)
+		  return GLErrorFlags::invalidValueFlag;
+    const GLenum target = textureObject.getTarget();
+    if (!GLRegister<GLType>::context.isValidTextureBindingTarget(target))
+      {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+    GLScopedSetValue<GLuint> _(GLRegister<GLType>::context.getActiveTextureBind(target), textureObject.getId());
+
+    glTexParameteri(target, parameterName, param);
+    jassertglsucceed(GLRegister<GLType>::context);
+    return GLErrorFlags::succeed;
+  }
+
+private:
+   const GLTextureObject& textureObject;
+};
+
+template <GLenum parameterName, GLint defaultValue = 0>
+class GLTextureFloatParameterRegister : public GLRegister<GLfloat>
+{
+public:
+  typedef GLfloat GLType;
+
+  GLTextureFloatParameterRegister(const GLTextureObject& textureObject)
+    : GLRegister<GLfloat>(textureObject.getContext()), textureObject(textureObject) {}
+
+  virtual GLfloat getDefaultValue() const
+    {return defaultValue;}
+
+  // Warning: possible OpenGL flush performance penalty.
+  virtual GLErrorFlags getValue(GLfloat& param) const
+  {
+    const GLenum target = textureObject.getTarget();
+    if (!context.isValidTextureBindingTarget(target))
+      {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+    DOCGL_CLEAR_ERROR_FLAGS(context, stateErrorCheck);
+    GLScopedSetValue<GLuint> _(context.getActiveTextureBind(target), textureObject.getId());
+    GLErrorFlags errorFlags = _.getConstructionState();
+    GLfloat floatValue = defaultValue;
+    if (errorFlags.hasSucceed())
+    {
+      glGetTexParameterfv(target, parameterName, &floatValue);
+      errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck);
+      if (errorFlags.hasErrors())
+        {jassertfalse;}
+    }
+    param = floatValue;
+    return errorFlags;
+  }
+
+  virtual GLErrorFlags setValue(const GLfloat& param)
+  {
+    // TODO check
+    //if (!context.isValidTextureParameter(parameterName, param))
+    //  {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+    const GLenum target = textureObject.getTarget();
+    if (!context.isValidTextureBindingTarget(target))
+      {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+    GLScopedSetValue<GLuint> _(context.getActiveTextureBind(target), textureObject.getId());
+
+    glTexParameterf(target, parameterName, param);
+    jassertglsucceed(context);
+    return GLErrorFlags::succeed;
+  }
+
+private:
+   const GLTextureObject& textureObject;
+};
+
+GLErrorFlags GLTextureObject::getBaseLevel(GLint& baseLevel) const
+  {baseLevel = samplingParameters.baseLevel; return GLErrorFlags::succeed;}
+GLErrorFlags GLTextureObject::getMaxLevel(GLint& maxLevel) const
+  {maxLevel = samplingParameters.maxLevel; return GLErrorFlags::succeed;}
+GLErrorFlags GLTextureObject::getCompareMode(GLenum& compareMode) const
+  {compareMode = samplingParameters.compareMode; return GLErrorFlags::succeed;}
+GLErrorFlags GLTextureObject::getCompareFunction(GLenum& compareFunction) const
+  {compareFunction = samplingParameters.compareFunction; return GLErrorFlags::succeed;}
+GLErrorFlags GLTextureObject::getLevelOfDetailBias(GLfloat& levelOfDetailBias) const
+  {levelOfDetailBias = samplingParameters.levelOfDetailBias; return GLErrorFlags::succeed;}
+GLErrorFlags GLTextureObject::getLevelOfDetailMax(GLfloat& levelOfDetailMax) const
+  {levelOfDetailMax = samplingParameters.levelOfDetailMax; return GLErrorFlags::succeed;}
+GLErrorFlags GLTextureObject::getLevelOfDetailMin(GLfloat& levelOfDetailMin) const
+  {levelOfDetailMin = samplingParameters.levelOfDetailMin; return GLErrorFlags::succeed;}
+GLErrorFlags GLTextureObject::getMagnificationFilter(GLenum& manificationFilter) const
+  {manificationFilter = samplingParameters.magnificationFilter; return GLErrorFlags::succeed;}
+GLErrorFlags GLTextureObject::getMinificationFilter(GLenum& minificationFilter) const
+  {minificationFilter = samplingParameters.minificationFilter; return GLErrorFlags::succeed;}
+GLErrorFlags GLTextureObject::getSwizzleRed(GLenum& swizzleRed) const
+  {swizzleRed = samplingParameters.swizzleRed; return GLErrorFlags::succeed;}
+GLErrorFlags GLTextureObject::getSwizzleGreen(GLenum& swizzleGreen) const
+  {swizzleGreen = samplingParameters.swizzleGreen; return GLErrorFlags::succeed;}
+GLErrorFlags GLTextureObject::getSwizzleBlue(GLenum& swizzleBlue) const
+  {swizzleBlue = samplingParameters.swizzleBlue; return GLErrorFlags::succeed;}
+GLErrorFlags GLTextureObject::getSwizzleAlpha(GLenum& swizzleAlpha) const
+  {swizzleAlpha = samplingParameters.swizzleAlpha; return GLErrorFlags::succeed;}
+GLErrorFlags GLTextureObject::getHorizontalWrapMode(GLenum& horizontalWrapMode) const
+  {horizontalWrapMode = samplingParameters.horizontalWrapMode; return GLErrorFlags::succeed;}
+GLErrorFlags GLTextureObject::getVerticalWrapMode(GLenum& verticalWrapMode) const
+  {verticalWrapMode = samplingParameters.verticalWrapMode; return GLErrorFlags::succeed;}
+GLErrorFlags GLTextureObject::getDepthWrapMode(GLenum& depthWrapMode) const
+  {depthWrapMode = samplingParameters.depthWrapMode; return GLErrorFlags::succeed;}
+
+GLErrorFlags GLTextureObject::setBaseLevel(GLint baseLevel)
+{
+  if (baseLevel < 0)
+    {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+  return setSamplingParameter(GL_TEXTURE_BASE_LEVEL, samplingParameters.baseLevel, baseLevel);
+}
+GLErrorFlags GLTextureObject::setMaxLevel(GLint maxLevel)
+{
+  if (maxLevel < 0)
+    {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+  return setSamplingParameter(GL_TEXTURE_MAX_LEVEL, samplingParameters.maxLevel, maxLevel);
+}
+
+GLErrorFlags GLTextureObject::setCompareMode(GLenum compareMode)
+{
+  if (!isValidCompareMode(compareMode))
+    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+  return setSamplingParameter(GL_TEXTURE_COMPARE_MODE, samplingParameters.compareMode, compareMode);
+}
+
+GLErrorFlags GLTextureObject::setCompareFunction(GLenum compareFunction)
+  {return setSamplingParameter(GL_TEXTURE_COMPARE_FUNC, samplingParameters.compareFunction, compareFunction);}
+GLErrorFlags GLTextureObject::setLevelOfDetailBias(GLfloat levelOfDetailBias)
+  {return setSamplingParameter(GL_TEXTURE_LOD_BIAS, samplingParameters.levelOfDetailBias, levelOfDetailBias);}
+GLErrorFlags GLTextureObject::setLevelOfDetailMax(GLfloat levelOfDetailMax)
+  {return setSamplingParameter(GL_TEXTURE_MAX_LOD, samplingParameters.levelOfDetailMax, levelOfDetailMax);}
+GLErrorFlags GLTextureObject::setLevelOfDetailMin(GLfloat levelOfDetailMin)
+  {return setSamplingParameter(GL_TEXTURE_MIN_LOD, samplingParameters.levelOfDetailMin, levelOfDetailMin);}
+GLErrorFlags GLTextureObject::setMagnificationFilter(GLenum magnificationFilter)
+{
+  if (!isValidMagnificationFilter(magnificationFilter))
+    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+  return setSamplingParameter(GL_TEXTURE_MAG_FILTER, samplingParameters.magnificationFilter, magnificationFilter);
+}
+GLErrorFlags GLTextureObject::setMinificationFilter(GLenum minificationFilter)
+{
+  if (!isValidMinificationFilter(minificationFilter))
+    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+  if (!isValidMinificationFilterForTarget(minificationFilter))
+    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+  return setSamplingParameter(GL_TEXTURE_MIN_FILTER, samplingParameters.minificationFilter, minificationFilter);
+}
+GLErrorFlags GLTextureObject::setSwizzleRed(GLenum swizzleRed)
+{
+  if (!isValidSwizzling(swizzleRed))
+    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+  return setSamplingParameter(GL_TEXTURE_SWIZZLE_R, samplingParameters.swizzleRed, swizzleRed);
+}
+GLErrorFlags GLTextureObject::setSwizzleGreen(GLenum swizzleGreen)
+{
+  if (!isValidSwizzling(swizzleGreen))
+    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+  return setSamplingParameter(GL_TEXTURE_SWIZZLE_G, samplingParameters.swizzleGreen, swizzleGreen);
+}
+GLErrorFlags GLTextureObject::setSwizzleBlue(GLenum swizzleBlue)
+{
+  if (!isValidSwizzling(swizzleBlue))
+    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+  return setSamplingParameter(GL_TEXTURE_SWIZZLE_B, samplingParameters.swizzleBlue, swizzleBlue);
+}
+GLErrorFlags GLTextureObject::setSwizzleAlpha(GLenum swizzleAlpha)
+{
+  if (!isValidSwizzling(swizzleAlpha))
+    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+  return setSamplingParameter(GL_TEXTURE_SWIZZLE_A, samplingParameters.swizzleAlpha, swizzleAlpha);
+}
+GLErrorFlags GLTextureObject::setHorizontalWrapMode(GLenum horizontalWrapMode)
+{
+  if (!isValidWrappingMode(horizontalWrapMode))
+    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+  if (!isValidWrappingModeForTarget(horizontalWrapMode))
+    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+  return setSamplingParameter(GL_TEXTURE_WRAP_S, samplingParameters.horizontalWrapMode, horizontalWrapMode);
+}
+GLErrorFlags GLTextureObject::setVerticalWrapMode(GLenum verticalWrapMode)
+{
+  if (!isValidWrappingMode(verticalWrapMode))
+    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+  if (!isValidWrappingModeForTarget(verticalWrapMode))
+    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+  return setSamplingParameter(GL_TEXTURE_WRAP_T, samplingParameters.verticalWrapMode, verticalWrapMode);
+}
+
+GLErrorFlags GLTextureObject::setDepthWrapMode(GLenum depthWrapMode)
+{
+  if (!isValidWrappingMode(depthWrapMode))
+    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+  if (!isValidWrappingModeForTarget(depthWrapMode))
+    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+  return setSamplingParameter(GL_TEXTURE_WRAP_R, samplingParameters.depthWrapMode, depthWrapMode);
+}
+
+GLErrorFlags GLTextureObject::setSamplingParameters(const GLTextureSamplingParameters& parameters)
+{
+  if (!isValidSamplingParameters(parameters) || !isValidSamplingParametersForTarget(parameters))
+    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+  if (!context.isValidTextureBindingTarget(target))
+    {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // uncreated texture
+
+  GLScopedSetValue<GLuint> _(context.getActiveTextureBind(target), id);
+  updateSamplingParameter(GL_TEXTURE_BASE_LEVEL, samplingParameters.baseLevel, parameters.baseLevel);
+  updateSamplingParameter(GL_TEXTURE_MAX_LEVEL, samplingParameters.maxLevel, parameters.maxLevel);
+  updateSamplingParameter(GL_TEXTURE_COMPARE_MODE, samplingParameters.compareMode, parameters.compareMode);
+  updateSamplingParameter(GL_TEXTURE_COMPARE_FUNC, samplingParameters.compareFunction, parameters.compareFunction);
+  updateSamplingParameter(GL_TEXTURE_LOD_BIAS, samplingParameters.levelOfDetailBias, parameters.levelOfDetailBias);
+  updateSamplingParameter(GL_TEXTURE_MAX_LOD, samplingParameters.levelOfDetailMax, parameters.levelOfDetailMax);
+  updateSamplingParameter(GL_TEXTURE_MIN_LOD, samplingParameters.levelOfDetailMin, parameters.levelOfDetailMin);
+  updateSamplingParameter(GL_TEXTURE_MAG_FILTER, samplingParameters.magnificationFilter, parameters.magnificationFilter);
+  updateSamplingParameter(GL_TEXTURE_MIN_FILTER, samplingParameters.minificationFilter, parameters.minificationFilter);
+  updateSamplingParameter(GL_TEXTURE_SWIZZLE_R, samplingParameters.swizzleRed, parameters.swizzleRed);
+  updateSamplingParameter(GL_TEXTURE_SWIZZLE_G, samplingParameters.swizzleGreen, parameters.swizzleGreen);
+  updateSamplingParameter(GL_TEXTURE_SWIZZLE_B, samplingParameters.swizzleBlue, parameters.swizzleBlue);
+  updateSamplingParameter(GL_TEXTURE_SWIZZLE_A, samplingParameters.swizzleAlpha, parameters.swizzleAlpha);
+  updateSamplingParameter(GL_TEXTURE_WRAP_S, samplingParameters.horizontalWrapMode, parameters.horizontalWrapMode);
+  updateSamplingParameter(GL_TEXTURE_WRAP_T, samplingParameters.verticalWrapMode, parameters.verticalWrapMode);
+  updateSamplingParameter(GL_TEXTURE_WRAP_R, samplingParameters.depthWrapMode, parameters.depthWrapMode);
+  jassertglsucceed(context);
+  return GLErrorFlags::succeed;
+}
+
+GLErrorFlags GLTextureObject::refreshSamplingParameters()
+{
+  if (!context.isValidTextureBindingTarget(target))
+    {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // uncreated texture
+
+  GLTextureSamplingParameters parameters(target);
+  GLErrorFlags errorFlags = GLTextureParameterRegister<GLint, GL_TEXTURE_BASE_LEVEL>(*this).getValue(parameters.baseLevel);
+  errorFlags.merge(GLTextureParameterRegister<GLint, GL_TEXTURE_MAX_LEVEL, 1000>(*this).getValue(parameters.maxLevel));
+  errorFlags.merge(GLTextureParameterRegister<GLenum, GL_TEXTURE_COMPARE_MODE, GL_NONE>(*this).getValue(parameters.compareMode));
+  errorFlags.merge(GLTextureParameterRegister<GLenum, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL>(*this).getValue(parameters.compareFunction));
+  errorFlags.merge(GLTextureFloatParameterRegister<GL_TEXTURE_LOD_BIAS>(*this).getValue(parameters.levelOfDetailBias));
+  errorFlags.merge(GLTextureFloatParameterRegister<GL_TEXTURE_MAX_LOD, 1000>(*this).getValue(parameters.levelOfDetailMax));
+  errorFlags.merge(GLTextureFloatParameterRegister<GL_TEXTURE_MIN_LOD, -1000>(*this).getValue(parameters.levelOfDetailMin));
+  errorFlags.merge(GLTextureParameterRegister<GLenum, GL_TEXTURE_MAG_FILTER, GL_LINEAR>(*this).getValue(parameters.magnificationFilter));
+  errorFlags.merge(GLTextureParameterRegister<GLenum, GL_TEXTURE_MIN_FILTER>(*this).getValue(parameters.minificationFilter));
+  errorFlags.merge(GLTextureParameterRegister<GLenum, GL_TEXTURE_SWIZZLE_R, GL_RED>(*this).getValue(parameters.swizzleRed));
+  errorFlags.merge(GLTextureParameterRegister<GLenum, GL_TEXTURE_SWIZZLE_G, GL_GREEN>(*this).getValue(parameters.swizzleGreen));
+  errorFlags.merge(GLTextureParameterRegister<GLenum, GL_TEXTURE_SWIZZLE_B, GL_BLUE>(*this).getValue(parameters.swizzleBlue));
+  errorFlags.merge(GLTextureParameterRegister<GLenum, GL_TEXTURE_SWIZZLE_A, GL_ALPHA>(*this).getValue(parameters.swizzleAlpha));
+  errorFlags.merge(GLTextureParameterRegister<GLenum, GL_TEXTURE_WRAP_S>(*this).getValue(parameters.horizontalWrapMode));
+  errorFlags.merge(GLTextureParameterRegister<GLenum, GL_TEXTURE_WRAP_T>(*this).getValue(parameters.verticalWrapMode));
+  errorFlags.merge(GLTextureParameterRegister<GLenum, GL_TEXTURE_WRAP_R>(*this).getValue(parameters.depthWrapMode));
+  if (errorFlags.hasSucceed())
+    samplingParameters = parameters;
+  return errorFlags;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+template <class GLTexturePropertyType, GLenum propertyName>
+class GLTextureProperty : public GLProperty<GLTexturePropertyType>
+{
+public:
+  typedef GLTexturePropertyType GLType;
+
+  GLTextureProperty(const GLTextureObject& textureObject, GLint level)
+    : GLProperty<GLType>(textureObject.getContext()), textureObject(textureObject), level(level)
+    {
+      jassert(level >= 0);
+      jassert(textureObject.isValid());
+    }
+
+  // Warning: possible OpenGL flush performance penalty.
+  virtual GLType getValue() const
+  {
+    const GLenum target = textureObject.getTarget();
+    jassert(GLProperty<GLType>::context.isValidTextureBindingTarget(target));
+    GLScopedSetValue<GLuint> _(GLProperty<GLType>::context.getActiveTextureBind(target), textureObject.getId());
+    GLint intValue = 0;
+    glGetTexLevelParameteriv(target, level, propertyName, &intValue);
+    jassertglsucceed(GLProperty<GLType>::context);
+    jassert(intValue >= 0);
+    return static_cast<GLType>(intValue);
+  }
+
+  virtual GLErrorFlags getValue(GLType& param) const
+  {
+    const GLenum target = textureObject.getTarget();
+    if (!GLProperty<GLType>::context.isValidTextureBindingTarget(target))
+      {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+    DOCGL_CLEAR_ERROR_FLAGS(GLProperty<GLType>::context, stateErrorCheck);
+    GLScopedSetValue<GLuint> _(GLProperty<GLType>::context.getActiveTextureBind(target), textureObject.getId());
+    GLErrorFlags errorFlags = _.getConstructionState();
+    GLint intValue = 0;
+    if (errorFlags.hasSucceed())
+    {
+      glGetTexLevelParameteriv(target, level, propertyName, &intValue);
+      errorFlags = DOCGL_POP_ERROR_FLAGS(GLProperty<GLType>::context, stateErrorCheck);
+      if (errorFlags.hasSucceed())
+      {
+        if (intValue < 0)
+          {jassertfalse; errorFlags = GLErrorFlags::invalidValueFlag;}
+      }
+      else
+        {jassertfalse;}
+    }
+    param = static_cast<GLType>(intValue);
+    return errorFlags;
+  }
+
+private:
+   const GLTextureObject& textureObject;
+   const GLint level;
+};
+
+// GLTextureObject
+GLErrorFlags GLTextureObject::refreshLevelProperties(GLint level)
+{
+  if (level < 0)
+    {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+  if (!context.isValidTextureBindingTarget(target))
+    {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // uncreated texture
+
+  GLTextureLevelProperties properties;
+  GLErrorFlags errorFlags = GLTextureProperty<GLsizei, GL_TEXTURE_WIDTH>(*this, level).getValue(properties.width);
+  errorFlags.merge(GLTextureProperty<GLsizei, GL_TEXTURE_HEIGHT>(*this, level).getValue(properties.height));
+  errorFlags.merge(GLTextureProperty<GLsizei, GL_TEXTURE_DEPTH>(*this, level).getValue(properties.depth));
+  errorFlags.merge(GLTextureProperty<GLsizei, GL_TEXTURE_SAMPLES>(*this, level).getValue(properties.numSamplesPerTexel));
+  errorFlags.merge(GLTextureProperty<GLint, GL_TEXTURE_INTERNAL_FORMAT>(*this, level).getValue(properties.internalFormat));
+  errorFlags.merge(GLTextureProperty<GLsizei, GL_TEXTURE_RED_SIZE>(*this, level).getValue(properties.numBitsForRed));
+  errorFlags.merge(GLTextureProperty<GLsizei, GL_TEXTURE_GREEN_SIZE>(*this, level).getValue(properties.numBitsForGreen));
+  errorFlags.merge(GLTextureProperty<GLsizei, GL_TEXTURE_BLUE_SIZE>(*this, level).getValue(properties.numBitsForBlue));
+  errorFlags.merge(GLTextureProperty<GLsizei, GL_TEXTURE_ALPHA_SIZE>(*this, level).getValue(properties.numBitsForAlpha));
+  errorFlags.merge(GLTextureProperty<GLsizei, GL_TEXTURE_DEPTH_SIZE>(*this, level).getValue(properties.numBitsForDepth));
+  errorFlags.merge(GLTextureProperty<GLsizei, GL_TEXTURE_STENCIL_SIZE>(*this, level).getValue(properties.numBitsForStencil));
+  errorFlags.merge(GLTextureProperty<GLboolean, GL_TEXTURE_COMPRESSED>(*this, level).getValue(properties.compressed));
+  if (properties.compressed)
+    errorFlags.merge(GLTextureProperty<GLsizei, GL_TEXTURE_COMPRESSED_IMAGE_SIZE>(*this, level).getValue(properties.compressedImageSize));
+  if (errorFlags.hasSucceed())
+    setLevelProperties(level, properties);
+  return errorFlags;
+}
+// todo add TEXTURE_FIXED_SAMPLE_LOCATIONS, TEXTURE_BUFFER_DATA_STORE_BINDING...
+
+//////////////////////////////////////////////////////////////////////////////
+
+// GLBufferObject::set batched update range
+struct GLBufferRange
+{
+  GLBufferRange(GLintptr offset = 0, GLsizeiptr size = 0, const GLvoid* data = NULL)
+    : offset(offset), size(size), data(data) {}
+
+  GLintptr offset;
+  GLsizeiptr size;
+  const GLvoid* data;
+};
+
+// Size, usage, storage flags and mapping state of the data store are tracked on the CPU side: range validations
+// never query OpenGL (untracked for objects adopted with setId).
+// Optional host mirror (setHostMirrorEnabled): a CPU copy of the content kept up to date by set/copyFrom, get reads it
+// without glGetBufferSubData synchronization (ranges written through mappings are reloaded once at the next get).
+class GLBufferObject : public GLObject
+{
+public:
+  GLBufferObject(GLContext& context)
+    : GLObject(context), size(-1), usage(0), storageFlags(0), mapAccess(0), mapOffset(0), mapLength(0), mapPointer(NULL)
+    , hostMirrorEnabled(false), staleBegin(0), staleEnd(0) {}
+
+  // Warning: possible OpenGL flush performance penalty.
+  GLErrorFlags create(GLsizeiptr size, const GLvoid* data, GLenum usage, GLenum temporaryTarget = GL_ARRAY_BUFFER)
+  {
+    jassert(!id); // overwritting existing: potential memory leak
+    jassert(size >= 0);
+    jassert(context.isValidBufferBindingTarget(temporaryTarget) && isValidUsage(usage));
+    glGenBuffers(1, &id);
+    jassertglsucceed(context);
+    jassert(id);
+
+    GLScopedSetValue<GLuint> _(context.getActiveBufferBind(temporaryTarget), id);
+    DOCGL_CLEAR_ERROR_FLAGS(context, resourceErrorCheck); // clear previous error ensure next popContextErrorFlags concern glBufferData
+    glBufferData(temporaryTarget, size, data, usage);
+    const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, resourceErrorCheck);
+    if (errorFlags.hasErrors())
+    {
+      _.cancelScopedValue(); // unbind before deletion seem's to be cleaner
+      destroy();
+    }
+    else
+      setDataStore(size, data, usage, 0);
+    return errorFlags;
+  }
+
+  // Immutable storage (this is not an OpenGL3.3 feature: ARB extension included in OpenGL 4.4)
+  // flags: GL_DYNAMIC_STORAGE_BIT, GL_MAP_READ_BIT, GL_MAP_WRITE_BIT, GL_MAP_PERSISTENT_BIT, GL_MAP_COHERENT_BIT, GL_CLIENT_STORAGE_BIT.
+  // Warning: possible OpenGL flush performance penalty.
+  GLErrorFlags createStorage(GLsizeiptr size, const GLvoid* data, GLbitfield flags, GLenum temporaryTarget = GL_ARRAY_BUFFER)
+  {
+    if (!context.hasCapability(bufferStorageCapability))
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
+    jassert(!id); // overwritting existing: potential memory leak
+    jassert(size > 0);
+    jassert(context.isValidBufferBindingTarget(temporaryTarget));
+    glGenBuffers(1, &id);
+    jassertglsucceed(context);
+    jassert(id);
+
+    GLScopedSetValue<GLuint> _(context.getActiveBufferBind(temporaryTarget), id);
+    DOCGL_CLEAR_ERROR_FLAGS(context, resourceErrorCheck);
+    glBufferStorage(temporaryTarget, size, data, flags);
+    const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, resourceErrorCheck);
+    if (errorFlags.hasErrors())
+    {
+      _.cancelScopedValue();
+      destroy();
+    }
+    else
+      setDataStore(size, data, 0, flags);
+    return errorFlags;
+  }
+
+  // delete the OpenGL object and forget the tracked data store state
+  void destroy()
+    {GLObject::destroy(); untrack();}
+
+  // adopt another OpenGL object: its data store is untracked (size, usage, mapping and host mirror are forgotten)
+  void setId(GLuint id)
+    {GLObject::setId(id); untrack();}
+
+  GLErrorFlags set(GLsizeiptr size, const GLvoid* data, GLintptr offset = 0, GLenum temporaryTarget = GL_ARRAY_BUFFER)
+  {
+    if (offset < 0 || size < 0)
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    if (!id)
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
+    if (!context.isValidBufferBindingTarget(temporaryTarget))
+      {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+    if (!isInDataStore(offset, size))
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;} // offset + size extends beyond the buffer object's allocated data store
+    if (!isSubDataUpdatable())
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // mapped or immutable storage without GL_DYNAMIC_STORAGE_BIT
+
+    GLScopedSetValue<GLuint> _(context.getActiveBufferBind(temporaryTarget), id);
+    glBufferSubData(temporaryTarget, offset, size, data);
+    jassertglsucceed(context);
+    updateHostMirror(offset, size, data);
+    return GLErrorFlags::succeed;
+  }
+
+  // Batched update under a single bind: adjacent or overlapping ranges are coalesced in one glBufferSubData
+  // (through a scratch copy unless their data are contiguous). Overlapping ranges are applied in list order (last wins).
+  GLErrorFlags set(const GLBufferRange* ranges, size_t numRanges, GLenum temporaryTarget = GL_ARRAY_BUFFER)
+  {
+    if (!ranges && numRanges)
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    if (!id || !isSubDataUpdatable())
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
+    if (!context.isValidBufferBindingTarget(temporaryTarget))
+      {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+
+    sortedRanges.clear();
+    for (size_t i = 0; i < numRanges; ++i)
+    {
+      const GLBufferRange& range = ranges[i];
+      if (range.offset < 0 || range.size < 0 || (range.size && !range.data) || !isInDataStore(range.offset, range.size))
+        {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+      if (range.size)
+        sortedRanges.push_back(SortedRange(range.offset, range.offset + range.size, i));
+    }
+    if (sortedRanges.empty())
+      return GLErrorFlags::succeed;
+    std::sort(sortedRanges.begin(), sortedRanges.end());
+
+    GLScopedSetValue<GLuint> _(context.getActiveBufferBind(temporaryTarget), id);
+    size_t first = 0;
+    while (first < sortedRanges.size())
+    {
+      // group [first, last) of touching ranges
+      GLintptr end = sortedRanges[first].end;
+      bool contiguousData = true;
+      size_t last = first + 1;
+      for (; last < sortedRanges.size() && sortedRanges[last].offset <= end; ++last)
+      {
+        const SortedRange& previous = sortedRanges[last - 1];
+        contiguousData = contiguousData && sortedRanges[last].offset == previous.end
+          && ranges[sortedRanges[last].index].data == static_cast<const GLubyte*>(ranges[previous.index].data) + (previous.end - previous.offset);
+        end = std::max(end, sortedRanges[last].end);
+      }
+
+      const GLintptr offset = sortedRanges[first].offset;
+      if (contiguousData)
+        glBufferSubData(temporaryTarget, offset, end - offset, ranges[sortedRanges[first].index].data);
+      else
+      {
+        scratch.resize(end - offset);
+        for (size_t i = 0; i < numRanges; ++i) // list order: last overlapping range wins
+          if (ranges[i].size && ranges[i].offset >= offset && ranges[i].offset + ranges[i].size <= end)
+            memcpy(&scratch[ranges[i].offset - offset], ranges[i].data, ranges[i].size);
+        glBufferSubData(temporaryTarget, offset, end - offset, &scratch[0]);
+      }
+      jassertglsucceed(context);
+      first = last;
+    }
+    for (size_t i = 0; i < numRanges; ++i) // list order: last overlapping range wins
+      updateHostMirror(ranges[i].offset, ranges[i].size, ranges[i].data);
+    return GLErrorFlags::succeed;
+  }
+
+  // Read back [offset, offset + size): from the host mirror when enabled, otherwise with glGetBufferSubData
+  // (Warning: waits for the GPU commands writing the buffer).
+  GLErrorFlags get(GLsizeiptr size, GLvoid* data, GLintptr offset = 0, GLenum temporaryTarget = GL_ARRAY_BUFFER)
+  {
+    if (offset < 0 || size < 0 || (size && !data) || !isInDataStore(offset, size))
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    if (!id)
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
+    if (!context.isValidBufferBindingTarget(temporaryTarget))
+      {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+    if (!hasHostMirror())
+    {
+      if (isMapped() && !(mapAccess & GL_MAP_PERSISTENT_BIT))
+        {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
+      GLScopedSetValue<GLuint> _(context.getActiveBufferBind(temporaryTarget), id);
+      glGetBufferSubData(temporaryTarget, offset, size, data);
+      jassertglsucceed(context);
+      return GLErrorFlags::succeed;
+    }
+
+    if (isStale(offset, size))
+    { // reload the ranges written through mappings
+      if (isMapped() && !(mapAccess & GL_MAP_PERSISTENT_BIT))
+        {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
+      GLScopedSetValue<GLuint> _(context.getActiveBufferBind(temporaryTarget), id);
+      glGetBufferSubData(temporaryTarget, staleBegin, staleEnd - staleBegin, &hostMirror[staleBegin]);
+      jassertglsucceed(context);
+      staleBegin = staleEnd = 0;
+      markPersistentMappingStale(); // the CPU can still write through the pointer
+    }
+    if (size)
+      memcpy(data, &hostMirror[offset], size);
+    return GLErrorFlags::succeed;
+  }
+
+  GLErrorFlags map(GLenum access, void** data, GLenum temporaryTarget = GL_ARRAY_BUFFER)
+  {
+    if (!data || !isValidAccess(access) || !context.isValidBufferBindingTarget(temporaryTarget))
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    if (!id || isMapped())
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // buffer object is already mapped
+
+    GLScopedSetValue<GLuint> _(context.getActiveBufferBind(temporaryTarget), id);
+    *data = glMapBuffer(temporaryTarget, access);
+    if (!*data)
+    { // in this error case only, we could have performance penalty
+      const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, failureErrorCheck);
+      jassert(errorFlags.hasErrors()); // hum hum: openGL say that if glMapBuffer return NULL, an error is generated
+      // outOfVideoMemoryFlag: can be a virtual memory problem
+      return errorFlags;
+    }
+    const GLbitfield rangeAccess = access == GL_READ_ONLY ? GL_MAP_READ_BIT
+      : (access == GL_WRITE_ONLY ? GL_MAP_WRITE_BIT : GL_MAP_READ_BIT | GL_MAP_WRITE_BIT);
+    setMapping(0, size, rangeAccess, *data);
+    return GLErrorFlags::succeed;
+  }
+
+  GLErrorFlags unmap(GLenum temporaryTarget = GL_ARRAY_BUFFER)
+  {
+    if (!context.isValidBufferBindingTarget(temporaryTarget))
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    if (!isMapped() && isTracked())
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // buffer object is not currently mapped
+
+    GLScopedSetValue<GLuint> _(context.getActiveBufferBind(temporaryTarget), id);
+    mapAccess = 0;
+    mapPointer = NULL;
+    if (glUnmapBuffer(temporaryTarget))
+      return GLErrorFlags::succeed;
+    else
+    {
+      const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, failureErrorCheck);
+      jassert(errorFlags.hasErrors()); // hum hum: openGL say that if glMapBuffer return NULL, an error is generated
+      return errorFlags;
+    }
+  }
+
+  // Explicit range mapping, no stall update patterns:
+  // - orphaning: GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT (the driver allocates a new data store if the GPU use the old one)
+  // - unsynchronized append: GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT on a range the GPU does'nt read (caller responsibility)
+  // - explicit flush: GL_MAP_WRITE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT then flushMappedRange on the written sub ranges only.
+  GLErrorFlags mapRange(GLintptr offset, GLsizeiptr length, GLbitfield access, void** data, GLenum temporaryTarget = GL_ARRAY_BUFFER)
+  {
+    if (!data || offset < 0 || length <= 0 || !isValidRangeAccess(access) || !context.isValidBufferBindingTarget(temporaryTarget))
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    if (!isInDataStore(offset, length))
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;} // range out of the buffer
+    if (!id || isMapped())
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // buffer object is already mapped
+
+    GLScopedSetValue<GLuint> _(context.getActiveBufferBind(temporaryTarget), id);
+    *data = glMapBufferRange(temporaryTarget, offset, length, access);
+    if (!*data)
+      return DOCGL_POP_ERROR_FLAGS(context, failureErrorCheck);
+    setMapping(offset, length, access, *data);
+    return GLErrorFlags::succeed;
+  }
+
+  // offset is relative to the mapped range (mapRange with GL_MAP_FLUSH_EXPLICIT_BIT).
+  GLErrorFlags flushMappedRange(GLintptr offset, GLsizeiptr length, GLenum temporaryTarget = GL_ARRAY_BUFFER)
+  {
+    if (offset < 0 || length < 0 || !context.isValidBufferBindingTarget(temporaryTarget))
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    if (isTracked() && !(mapAccess & GL_MAP_FLUSH_EXPLICIT_BIT))
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // not mapped with GL_MAP_FLUSH_EXPLICIT_BIT
+    if (isTracked() && offset + length > mapLength)
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+
+    GLScopedSetValue<GLuint> _(context.getActiveBufferBind(temporaryTarget), id);
+    glFlushMappedBufferRange(temporaryTarget, offset, length);
+    jassertglsucceed(context);
+    return GLErrorFlags::succeed;
+  }
+
+  // Tell the driver the content is not needed anymore: next updates don't wait for the GPU.
+  // Without ARB_invalidate_subdata: the whole data store is orphaned with glBufferData(NULL).
+  GLErrorFlags invalidate(GLenum temporaryTarget = GL_ARRAY_BUFFER)
+  {
+    if (!id || isMapped())
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
+    if (isTracked())
+      markStale(0, size); // the mirror must not show the discarded content
+    if (context.hasCapability(invalidateSubdataCapability))
+    {
+      glInvalidateBufferData(id);
+      jassertglsucceed(context);
+      return GLErrorFlags::succeed;
+    }
+    if (isTracked() && isImmutable())
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // immutable storage could not be orphaned
+    if (!context.isValidBufferBindingTarget(temporaryTarget))
+      {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+
+    GLScopedSetValue<GLuint> _(context.getActiveBufferBind(temporaryTarget), id);
+    if (isTracked())
+      glBufferData(temporaryTarget, size, NULL, usage);
+    else
+    {
+      GLint queriedSize = 0, queriedUsage = GL_STATIC_DRAW;
+      glGetBufferParameteriv(temporaryTarget, GL_BUFFER_SIZE, &queriedSize);
+      glGetBufferParameteriv(temporaryTarget, GL_BUFFER_USAGE, &queriedUsage);
+      glBufferData(temporaryTarget, queriedSize, NULL, queriedUsage);
+    }
+    jassertglsucceed(context); // invalidOperationFlag on untracked immutable storage
+    return GLErrorFlags::succeed;
+  }
+
+  // Without ARB_invalidate_subdata: the range is mapped with GL_MAP_INVALIDATE_RANGE_BIT.
+  GLErrorFlags invalidateRange(GLintptr offset, GLsizeiptr length, GLenum temporaryTarget = GL_ARRAY_BUFFER)
+  {
+    if (offset < 0 || length <= 0 || !isInDataStore(offset, length))
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    if (!id || isMapped())
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
+    markStale(offset, length);
+    if (context.hasCapability(invalidateSubdataCapability))
+    {
+      glInvalidateBufferSubData(id, offset, length);
+      jassertglsucceed(context);
+      return GLErrorFlags::succeed;
+    }
+    void* data;
+    GLErrorFlags errorFlags = mapRange(offset, length, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT, &data, temporaryTarget);
+    if (errorFlags.hasSucceed())
+      errorFlags = unmap(temporaryTarget);
+    return errorFlags;
+  }
+
+  // GPU side copy from source [sourceOffset, sourceOffset + size) (no CPU synchronization, source can be this buffer
+  // if the ranges do not overlap). Copy read/write binds are write only registers: they are set and not restored.
+  GLErrorFlags copyFrom(const GLBufferObject& source, GLintptr sourceOffset, GLintptr destinationOffset, GLsizeiptr size)
+  {
+    if (sourceOffset < 0 || destinationOffset < 0 || size < 0)
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    if (source.getId() == id && sourceOffset < destinationOffset + size && destinationOffset < sourceOffset + size)
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;} // overlapping ranges in the same buffer
+    if (!source.isInDataStore(sourceOffset, size) || !isInDataStore(destinationOffset, size))
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;} // a range extends beyond its buffer
+    if (!id || !source.getId() || !source.isCopyable() || !isCopyable())
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // a buffer is mapped
+
+    GLErrorFlags errorFlags = context.getActiveBufferBind(GL_COPY_READ_BUFFER).setValue(source.getId());
+    errorFlags.merge(context.getActiveBufferBind(GL_COPY_WRITE_BUFFER).setValue(id));
+    if (errorFlags.hasErrors())
+      return errorFlags;
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sourceOffset, destinationOffset, size);
+    jassertglsucceed(context);
+
+    if (hasHostMirror())
+    {
+      if (source.hasHostMirror() && !source.isStale(sourceOffset, size))
+        updateHostMirror(destinationOffset, size, &source.hostMirror[sourceOffset]);
+      else
+        markStale(destinationOffset, size);
+    }
+    return GLErrorFlags::succeed;
+  }
+
+  // Host mirror (off by default): enabling it on a created buffer loads the content at the next get.
+  // Not available on objects adopted with setId (untracked size).
+  void setHostMirrorEnabled(bool enabled)
+  {
+    if (enabled && id && !isTracked())
+      {jassertfalse; return;}
+    hostMirrorEnabled = enabled;
+    hostMirror.clear();
+    staleBegin = staleEnd = 0;
+    if (enabled && size > 0)
+    {
+      hostMirror.resize(size);
+      markStale(0, size);
+    }
+  }
+
+  bool isHostMirrorEnabled() const
+    {return hostMirrorEnabled;}
+
+  // Content written by other means than set and copyFrom (GLStagingBuffer uploads...): no OpenGL call.
+  void updateHostMirror(GLintptr offset, GLsizeiptr size, const GLvoid* data)
+  {
+    if (!hasHostMirror() || size <= 0)
+      return;
+    if (offset < 0 || offset + size > static_cast<GLintptr>(hostMirror.size()) || !data)
+      {jassertfalse; return;}
+    memcpy(&hostMirror[offset], data, size);
+    if (offset <= staleBegin && staleBegin < offset + size) // trim the reload range
+      staleBegin = std::min(staleEnd, offset + size);
+    if (offset < staleEnd && staleEnd <= offset + size)
+      staleEnd = std::max(staleBegin, offset);
+    markPersistentMappingStale();
+  }
+
+  // tracked data store state (no OpenGL query)
+  bool isTracked() const
+    {return size >= 0;} // false for objects adopted with setId
+  GLsizeiptr getSize() const
+    {return size;}
+  GLenum getUsage() const
+    {return usage;} // 0 on immutable storage
+  GLbitfield getStorageFlags() const
+    {return storageFlags;}
+  bool isImmutable() const
+    {return usage == 0 && isTracked();}
+  bool isMapped() const
+    {return mapAccess != 0;}
+  GLbitfield getMapAccess() const
+    {return mapAccess;} // GL_MAP_xxx_BIT (glMapBuffer access translated)
+  GLintptr getMapOffset() const
+    {return mapOffset;}
+  GLsizeiptr getMapLength() const
+    {return mapLength;}
+  void* getMapPointer() const
+    {return mapPointer;}
+
+protected:
+  // GLObject interface
+  virtual GLboolean isValidName(GLuint id) const
+    {return glIsBuffer(id);}
+  virtual void deleteNames(GLuint id) const
+    {context.notifyBufferDeletion(id); glDeleteBuffers(1, &id);}
+
+private:
+  static bool isValidUsage(GLenum usage)
+  {
+    switch (usage)
+    {
+    case GL_STREAM_DRAW:
+    case GL_STREAM_READ:
+    case GL_STREAM_COPY:
+    case GL_STATIC_DRAW:
+    case GL_STATIC_READ:
+    case GL_STATIC_COPY:
+    case GL_DYNAMIC_DRAW:
+    case GL_DYNAMIC_READ:
+    case GL_DYNAMIC_COPY:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  static bool isValidAccess(GLenum access)
+    {return access == GL_READ_ONLY || access == GL_WRITE_ONLY || access == GL_READ_WRITE;}
+
+  static bool isValidRangeAccess(GLbitfield access)
+  {
+    const GLbitfield validBits = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT
+      | GL_MAP_FLUSH_EXPLICIT_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLbitfield writeOnlyBits = GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+    if (access & ~validBits)
+      return false;
+    if (!(access & (GL_MAP_READ_BIT | GL_MAP_WRITE_BIT)))
+      return false; // at least one of read or write
+    if ((access & GL_MAP_READ_BIT) && (access & writeOnlyBits))
+      return false;
+    if ((access & GL_MAP_FLUSH_EXPLICIT_BIT) && !(access & GL_MAP_WRITE_BIT))
+      return false;
+    return true;
+  }
+
+  void setDataStore(GLsizeiptr size, const GLvoid* data, GLenum usage, GLbitfield storageFlags)
+  {
+    this->size = size;
+    this->usage = usage;
+    this->storageFlags = storageFlags;
+    mapAccess = 0;
+    mapPointer = NULL;
+    staleBegin = staleEnd = 0;
+    if (hostMirrorEnabled)
+    {
+      hostMirror.assign(size, 0);
+      updateHostMirror(0, data ? size : 0, data);
+    }
+  }
+
+  void untrack()
+  {
+    size = -1;
+    usage = 0;
+    storageFlags = 0;
+    mapAccess = 0;
+    mapOffset = mapLength = 0;
+    mapPointer = NULL;
+    hostMirror.clear();
+    staleBegin = staleEnd = 0;
+  }
+
+  void setMapping(GLintptr offset, GLsizeiptr length, GLbitfield access, void* pointer)
   {
-    return swizzling == GL_RED || swizzling == GL_GREEN ||
-      swizzling == GL_BLUE || swizzling == GL_ALPHA ||
-      swizzling == GL_ZERO || swizzling == GL_ONE;
+    mapOffset = offset;
+    mapLength = length;
+    mapAccess = access;
+    mapPointer = pointer;
+    if (access & GL_MAP_WRITE_BIT)
+      markStale(offset, length); // writes through the mapping are not seen by the host mirror
   }
 
-  static bool isValidWrappingMode(GLenum wrappingMode)
-    {return wrappingMode == GL_CLAMP_TO_EDGE || wrappingMode == GL_REPEAT ||
-      wrappingMode == GL_CLAMP_TO_BORDER || wrappingMode == GL_MIRRORED_REPEAT;}
+  // untracked objects are not validated (OpenGL reports the error)
+  bool isInDataStore(GLintptr offset, GLsizeiptr length) const
+    {return !isTracked() || offset + length <= size;}
 
-protected:
-  // GLObject interface
-  virtual GLboolean isValidName(GLuint id) const
-    {return glIsTexture(id);}
-  virtual void deleteNames(GLuint id) const
-    {glDeleteTextures(1, &id);}
+  bool isSubDataUpdatable() const
+  {
+    if (isMapped() && !(mapAccess & GL_MAP_PERSISTENT_BIT))
+      return false;
+    return !isImmutable() || (storageFlags & GL_DYNAMIC_STORAGE_BIT);
+  }
 
-private:
-  GLenum target;
+  bool isCopyable() const
+    {return !isMapped() || (mapAccess & GL_MAP_PERSISTENT_BIT);}
+
+  // enabled and sized on the tracked data store
+  bool hasHostMirror() const
+    {return hostMirrorEnabled && isTracked() && hostMirror.size() == static_cast<size_t>(size);}
+
+  void markStale(GLintptr offset, GLsizeiptr length)
+  {
+    if (!hasHostMirror() || length <= 0)
+      return;
+    if (staleBegin >= staleEnd)
+      {staleBegin = offset; staleEnd = offset + length;}
+    else
+      {staleBegin = std::min(staleBegin, offset); staleEnd = std::max(staleEnd, offset + length);}
+  }
+
+  // a persistent write mapping can change its range at any time: it is never considered up to date
+  void markPersistentMappingStale()
+  {
+    if ((mapAccess & GL_MAP_PERSISTENT_BIT) && (mapAccess & GL_MAP_WRITE_BIT))
+      markStale(mapOffset, mapLength);
+  }
+
+  bool isStale(GLintptr offset, GLsizeiptr length) const
+    {return staleBegin < staleEnd && offset < staleEnd && staleBegin < offset + length;}
+
+  // tracked data store state
+  GLsizeiptr size; // -1: untracked
+  GLenum usage;
+  GLbitfield storageFlags;
+  GLbitfield mapAccess;
+  GLintptr mapOffset;
+  GLsizeiptr mapLength;
+  void* mapPointer;
+
+  // host mirror, [staleBegin, staleEnd) must be reloaded from OpenGL
+  bool hostMirrorEnabled;
+  std::vector<GLubyte> hostMirror;
+  GLintptr staleBegin;
+  GLintptr staleEnd;
+
+  // batched set working memory (kept between calls to avoid per frame allocations)
+  struct SortedRange
+  {
+    SortedRange(GLintptr offset, GLintptr end, size_t index)
+      : offset(offset), end(end), index(index) {}
+
+    bool operator <(const SortedRange& other) const
+      {return offset < other.offset || (offset == other.offset && index < other.index);}
+
+    GLintptr offset;
+    GLintptr end;
+    size_t index; // in the caller list
+  };
+  std::vector<SortedRange> sortedRanges;
+  std::vector<GLubyte> scratch;
 };
 
 //////////////////////////////////////////////////////////////////////////////
 
-template <class GLTextureParameterType, GLenum parameterName, GLint defaultValue = 0>
-class GLTextureParameterRegister : public GLRegister<GLTextureParameterType>
+// Per frame dynamic data ring: a frame reserves a window of the ring (beginFrame), sub-allocations bump a pointer
+// inside it without lock (worker threads can write their data), endFrame fences the window: the GPU reading regions
+// are reused only once their fence is signaled.
+// Storage is persistently mapped (ARB_buffer_storage, coherent) when available, otherwise each window is mapped
+// unsynchronized with glMapBufferRange (the fences already protect in flight regions) and explicitly flushed.
+// Frame order: beginFrame, allocate and write, commit, draws and bindRange reading the allocations, endFrame.
+// (without persistent mapping, the buffer can't be used by draws while it is mapped: commit unmaps it)
+class GLStreamingBuffer
 {
 public:
-  typedef GLTextureParameterType GLType;
+  struct Allocation
+  {
+    Allocation()
+      : offset(0), size(0), data(NULL) {}
 
-  GLTextureParameterRegister(const GLTextureObject& textureObject)
-    : GLRegister<GLType>(textureObject.getContext()), textureObject(textureObject) {}
+    GLintptr offset;  // in getBuffer(), for linkAttributeToBuffer, bindRange...
+    GLsizeiptr size;
+    void* data;       // write only, valid until commit
+  };
 
-  virtual GLType getDefaultValue() const
-    {return static_cast<GLType>(defaultValue);}
+  GLStreamingBuffer(GLContext& context)
+    : context(context), buffer(context), persistentData(NULL), size(0), target(GL_ARRAY_BUFFER)
+    , frameStarted(false), windowData(NULL), windowStart(0), windowEnd(0), committedEnd(0), offset(0)
+    , head(0), firstFrame(0), numFramesInFlight(0) {}
 
-  // Warning: possible OpenGL flush performance penalty.
-  virtual GLErrorFlags getValue(GLType& param) const
+  ~GLStreamingBuffer()
+    {jassert(!buffer.getId());} // call destroy before destruction
+
+  // target: binding target used to create and map the buffer
+  GLErrorFlags create(GLsizeiptr size, GLenum target = GL_ARRAY_BUFFER)
   {
-    const GLenum target = textureObject.getTarget();
-    if (!GLRegister<GLType>::context.isValidTextureBindingTarget(target))
-      {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
-    GLRegister<GLType>::context.clearErrorFlags();
-    GLScopedSetValue<GLuint> _(GLRegister<GLType>::context.getActiveTextureBind(target), textureObject.getId());
-    GLErrorFlags errorFlags = _.getConstructionState();
-    GLint intValue = defaultValue;
-    if (errorFlags.hasSucceed())
+    jassert(!buffer.getId());
+    if (size <= 0 || !context.isValidBufferBindingTarget(target))
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    this->size = size;
+    this->target = target;
+    head = windowStart = windowEnd = committedEnd = 0;
+    firstFrame = numFramesInFlight = 0;
+    frameStarted = false;
+    offset.store(0);
+
+    if (!context.hasCapability(bufferStorageCapability))
+      return buffer.create(size, NULL, GL_STREAM_DRAW, target);
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLErrorFlags errorFlags = buffer.createStorage(size, NULL, flags, target);
+    if (errorFlags.hasErrors())
+      return errorFlags;
+    errorFlags = buffer.mapRange(0, size, flags, &persistentData, target);
+    if (errorFlags.hasErrors())
+      {persistentData = NULL; buffer.destroy();}
+    return errorFlags;
+  }
+
+  // wait the GPU for all in flight frames, then delete the buffer.
+  void destroy()
+  {
+    if (!buffer.getId())
+      {jassertfalse; return;}
+    while (numFramesInFlight)
+      retireOldestFrame(true);
+    if (persistentData || windowData)
+      buffer.unmap(target);
+    persistentData = windowData = NULL;
+    frameStarted = false;
+    buffer.destroy();
+  }
+
+  bool isPersistent() const
+    {return persistentData != NULL;}
+
+  // Reserve frameSize contiguous bytes for the frame allocations (waits for the GPU only when the ring is full).
+  GLErrorFlags beginFrame(GLsizeiptr frameSize)
+  {
+    if (!buffer.getId() || frameStarted)
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // not created or endFrame missing
+    if (frameSize <= 0 || frameSize > size)
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+
+    while (numFramesInFlight && isSignaled(frames[firstFrame])) // free what the GPU already consumed
+      retireOldestFrame(false);
+    for (;;)
     {
-      glGetTexParameteriv(target, parameterName, &intValue);
-      errorFlags = GLRegister<GLType>::context.popErrorFlags();
-      if (errorFlags.hasSucceed())
+      if (!numFramesInFlight)
       {
-        if (intValue < 0)
-          {jassertfalse; errorFlags = GLErrorFlags::invalidValueFlag;}
+        if (head + frameSize > size)
+          head = 0;
+        break;
       }
-      else
-        {jassertfalse;}
+      const GLintptr tail = frames[firstFrame].start; // oldest region still read by the GPU
+      if (head > tail && size - head >= frameSize)
+        break;
+      if (head > tail && tail >= frameSize)
+        {head = 0; break;} // wrap
+      if (head < tail && tail - head >= frameSize)
+        break;
+      retireOldestFrame(true); // ring full: wait for the GPU
     }
-    param = static_cast<GLType>(intValue);
-    return errorFlags;
+
+    windowStart = head;
+    windowEnd = head + frameSize;
+    offset.store(windowStart);
+    if (persistentData)
+      windowData = static_cast<GLubyte*>(persistentData) + windowStart;
+    else
+    {
+      const GLErrorFlags errorFlags = buffer.mapRange(windowStart, frameSize,
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT, &windowData, target);
+      if (errorFlags.hasErrors())
+        {windowData = NULL; return errorFlags;}
+    }
+    frameStarted = true;
+    return GLErrorFlags::succeed;
   }
 
-  virtual GLErrorFlags setValue(const GLType& param)
+  // Lock free (any thread between beginFrame and commit): alignment must be a power of two.
+  // Return outOfVideoMemoryFlag if the frame window is exhausted.
+  GLErrorFlags allocate(GLsizeiptr allocationSize, GLsizeiptr alignment, Allocation& allocation)
   {
-    // TODO check
-    //if (!context.isValidTextureParameter(parameterName, param))
-    //  {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
-    if (param < 0)
-		  return GLErrorFlags::invalidValueFlag;
-    const GLenum target = textureObject.getTarget();
-    if (!GLRegister<GLType>::context.isValidTextureBindingTarget(target))
+    if (allocationSize <= 0 || alignment <= 0 || (alignment & (alignment - 1)))
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    if (!windowData)
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // beginFrame missing or frame already committed
+
+    GLintptr current = offset.load(std::memory_order_relaxed);
+    GLintptr aligned;
+    do
+    {
+      aligned = (current + alignment - 1) & ~(GLintptr)(alignment - 1);
+      if (aligned + allocationSize > windowEnd)
+        {jassertfalse; return GLErrorFlags::outOfVideoMemoryFlag;} // beginFrame frameSize is too small
+    }
+    while (!offset.compare_exchange_weak(current, aligned + allocationSize, std::memory_order_relaxed));
+
+    allocation.offset = aligned;
+    allocation.size = allocationSize;
+    allocation.data = static_cast<GLubyte*>(windowData) + (aligned - windowStart);
+    return GLErrorFlags::succeed;
+  }
+
+  // uniform block data: aligned on the implementation uniform buffer offset alignment.
+  GLErrorFlags allocateUniforms(GLsizeiptr allocationSize, Allocation& allocation)
+  {
+    const GLint alignment = context.getLimits().uniformBufferOffsetAlignment;
+    return allocate(allocationSize, alignment > 0 ? alignment : 1, allocation);
+  }
+
+  // indexed binding (GL_UNIFORM_BUFFER, GL_TRANSFORM_FEEDBACK_BUFFER) of an allocation.
+  GLErrorFlags bindRange(GLenum target, GLuint index, const Allocation& allocation)
+  {
+    if (target != GL_UNIFORM_BUFFER && target != GL_TRANSFORM_FEEDBACK_BUFFER)
       {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
-    GLScopedSetValue<GLuint> _(GLRegister<GLType>::context.getActiveTextureBind(target), textureObject.getId());
+    // glBindBufferRange also binds the generic target: keep the context register consistent.
+    GLScopedSetValue<GLuint> _(context.getActiveBufferBind(target), buffer.getId());
+    glBindBufferRange(target, index, buffer.getId(), allocation.offset, allocation.size);
+    jassertglsucceed(context);
+    return GLErrorFlags::succeed;
+  }
 
-    glTexParameteri(target, parameterName, param);
-    jassertglsucceed(GLRegister<GLType>::context);
+  // End the frame writes (on the context thread, once the writer threads are done): flush the allocated part of the
+  // window and unmap it. Call before the draws reading the frame allocations: their data pointers are invalid afterwards.
+  GLErrorFlags commit()
+  {
+    if (!windowData)
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // beginFrame missing or frame already committed
+    committedEnd = offset.load();
+    windowData = NULL;
+    if (persistentData)
+      return GLErrorFlags::succeed; // coherent mapping: writes are visible to the next commands
+
+    GLErrorFlags errorFlags;
+    if (committedEnd > windowStart)
+      errorFlags = buffer.flushMappedRange(0, committedEnd - windowStart, target);
+    const GLErrorFlags unmapErrorFlags = buffer.unmap(target);
+    if (unmapErrorFlags.hasErrors())
+      committedEnd = windowEnd; // data store corrupted, region content is undefined anyway
+    errorFlags.merge(unmapErrorFlags);
+    return errorFlags;
+  }
+
+  // Fence the frame window: call after the draws reading the frame allocations have been submitted.
+  GLErrorFlags endFrame()
+  {
+    if (!frameStarted || windowData)
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // beginFrame or commit missing
+    frameStarted = false;
+
+    if (numFramesInFlight == maxFramesInFlight)
+      retireOldestFrame(true);
+    if (committedEnd == windowStart) // nothing allocated
+      return GLErrorFlags::succeed;
+    Frame& frame = frames[(firstFrame + numFramesInFlight) % maxFramesInFlight];
+    frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frame.start = windowStart;
+    ++numFramesInFlight;
+    head = committedEnd;
+    jassertglsucceed(context);
     return GLErrorFlags::succeed;
   }
 
+  GLBufferObject& getBuffer()
+    {return buffer;}
+  GLuint getId() const
+    {return buffer.getId();}
+  GLsizeiptr getSize() const
+    {return size;}
+  size_t getNumFramesInFlight() const
+    {return numFramesInFlight;}
+
+# ifdef GLEW_MX
+  GLEWContext* glewGetContext() const
+    {return context.glewGetContext();}
+# endif // GLEW_MX
+
 private:
-   const GLTextureObject& textureObject;
+  enum {maxFramesInFlight = 8};
+
+  struct Frame
+  {
+    GLsync fence;
+    GLintptr start;
+  };
+
+  bool isSignaled(const Frame& frame) const
+  {
+    const GLenum status = glClientWaitSync(frame.fence, 0, 0);
+    return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+  }
+
+  // wait: block until the GPU have consumed the oldest frame
+  void retireOldestFrame(bool wait)
+  {
+    jassert(numFramesInFlight);
+    Frame& frame = frames[firstFrame];
+    if (wait)
+      while (glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000)) == GL_TIMEOUT_EXPIRED) {}
+    glDeleteSync(frame.fence);
+    firstFrame = (firstFrame + 1) % maxFramesInFlight;
+    --numFramesInFlight;
+  }
+
+  GLContext& context;
+  GLBufferObject buffer;
+  void* persistentData;
+  GLsizeiptr size;
+  GLenum target;
+
+  // current frame window
+  bool frameStarted;  // between beginFrame and endFrame
+  void* windowData;   // between beginFrame and commit
+  GLintptr windowStart;
+  GLintptr windowEnd;
+  GLintptr committedEnd; // allocations end at commit
+  std::atomic<GLintptr> offset; // next free byte in the window
+
+  // ring
+  GLintptr head; // end of the last fenced frame
+  Frame frames[maxFramesInFlight];
+  size_t firstFrame;
+  size_t numFramesInFlight;
 };
 
-template <GLenum parameterName, GLint defaultValue = 0>
-class GLTextureFloatParameterRegister : public GLRegister<GLfloat>
+//////////////////////////////////////////////////////////////////////////////
+
+class GLVertexArrayObject : public GLObject
 {
 public:
-  typedef GLfloat GLType;
+  GLVertexArrayObject(GLContext& context)
+    : GLObject(context) {}
 
-  GLTextureFloatParameterRegister(const GLTextureObject& textureObject)
-    : GLRegister<GLfloat>(textureObject.getContext()), textureObject(textureObject) {}
+  GLErrorFlags create()
+  {
+    jassert(!id); // overwritting existing: potential memory leak
+    glGenVertexArrays(1, &id);
+    jassertglsucceed(context);
+    jassert(id);
 
-  virtual GLfloat getDefaultValue() const
-    {return defaultValue;}
+    GLScopedSetValue<GLuint> _(context.getActiveVertexArrayBind(), id);
+    jassertglsucceed(context);
+    // todo others user friendly things before leaving
+    return DOCGL_POP_ERROR_FLAGS(context, resourceErrorCheck);
+  }
 
-  // Warning: possible OpenGL flush performance penalty.
-  virtual GLErrorFlags getValue(GLfloat& param) const
+  static bool isValidComponentPerVertexAttributeCount(GLint count)
+    {return (count >= 1 && count <= 4) || (count == GL_BGRA);}
+
+  // offset: first attribute byte in the buffer (GLStreamingBuffer allocations...)
+  GLErrorFlags linkAttributeToBuffer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLuint bufferId, GLintptr offset = 0)
   {
-    const GLenum target = textureObject.getTarget();
-    if (!context.isValidTextureBindingTarget(target))
-      {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
-    context.clearErrorFlags();
-    GLScopedSetValue<GLuint> _(context.getActiveTextureBind(target), textureObject.getId());
-    GLErrorFlags errorFlags = _.getConstructionState();
-    GLfloat floatValue = defaultValue;
-    if (errorFlags.hasSucceed())
-    {
-      glGetTexParameterfv(target, parameterName, &floatValue);
-      errorFlags = context.popErrorFlags();
-      if (errorFlags.hasErrors())
-        {jassertfalse;}
-    }
-    param = floatValue;
-    return errorFlags;
+    // todo check type
+    if (!context.isValidVertexAttributeIndex(index) || !isValidComponentPerVertexAttributeCount(size) || !bufferId)
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+
+    GLScopedSetValue<GLuint> _(context.getActiveVertexArrayBind(), id);
+    glEnableVertexAttribArray(index);
+    jassertglsucceed(context);
+
+    GLScopedSetValue<GLuint> __(context.getActiveBufferBind(GL_ARRAY_BUFFER), bufferId);
+    glVertexAttribPointer(index, size, type, normalized, 0, reinterpret_cast<const GLvoid*>(offset));
+    jassertglsucceed(context);
+
+    return GLErrorFlags::succeed;
   }
 
-  virtual GLErrorFlags setValue(const GLfloat& param)
+  GLErrorFlags unLinkAttribute(GLuint index)
   {
-    // TODO check
-    //if (!context.isValidTextureParameter(parameterName, param))
-    //  {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
-    const GLenum target = textureObject.getTarget();
-    if (!context.isValidTextureBindingTarget(target))
-      {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
-    GLScopedSetValue<GLuint> _(context.getActiveTextureBind(target), textureObject.getId());
-
-    glTexParameterf(target, parameterName, param);
+    if (!context.isValidVertexAttributeIndex(index))
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    GLScopedSetValue<GLuint> _(context.getActiveVertexArrayBind(), id);
+    glDisableVertexAttribArray(index);
     jassertglsucceed(context);
     return GLErrorFlags::succeed;
   }
 
-private:
-   const GLTextureObject& textureObject;
-};
+  // element array buffer is a vertex array state: drawElements read indices from it.
+  GLErrorFlags linkElementsToBuffer(GLuint bufferId)
+  {
+    if (!bufferId)
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    GLScopedSetValue<GLuint> _(context.getActiveVertexArrayBind(), id);
+    return context.getActiveBufferBind(GL_ELEMENT_ARRAY_BUFFER).setValue(bufferId); // not scoped: recorded in the vertex array
+  }
 
-GLErrorFlags GLTextureObject::getBaseLevel(GLint& baseLevel) const
-  {return GLTextureParameterRegister<GLint, GL_TEXTURE_BASE_LEVEL>(*this).getValue(baseLevel);}
-GLErrorFlags GLTextureObject::getMaxLevel(GLint& maxLevel) const
-  {return GLTextureParameterRegister<GLint, GL_TEXTURE_MAX_LEVEL, 1000>(*this).getValue(maxLevel);}
-GLErrorFlags GLTextureObject::getCompareMode(GLenum& compareMode) const
-  {return GLTextureParameterRegister<GLenum, GL_TEXTURE_COMPARE_MODE, GL_NONE>(*this).getValue(compareMode);}
-GLErrorFlags GLTextureObject::getCompareFunction(GLenum& compareFunction) const
-  {return GLTextureParameterRegister<GLenum, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL>(*this).getValue(compareFunction);}
-GLErrorFlags GLTextureObject::getLevelOfDetailBias(GLfloat& levelOfDetailBias) const
-  {return GLTextureFloatParameterRegister<GL_TEXTURE_LOD_BIAS>(*this).getValue(levelOfDetailBias);}
-GLErrorFlags GLTextureObject::getLevelOfDetailMax(GLfloat& levelOfDetailMax) const
-  {return GLTextureFloatParameterRegister<GL_TEXTURE_MAX_LOD, 1000>(*this).getValue(levelOfDetailMax);}
-GLErrorFlags GLTextureObject::getLevelOfDetailMin(GLfloat& levelOfDetailMin) const
-  {return GLTextureFloatParameterRegister<GL_TEXTURE_MIN_LOD, -1000>(*this).getValue(levelOfDetailMin);}
-GLErrorFlags GLTextureObject::getMagnificationFilter(GLenum& manificationFilter) const
-  {return GLTextureParameterRegister<GLenum, GL_TEXTURE_MAG_FILTER, GL_LINEAR>(*this).getValue(manificationFilter);}
-GLErrorFlags GLTextureObject::getMinificationFilter(GLenum& minificationFilter) const
-{
-  if (target == GL_TEXTURE_RECTANGLE)
-    return GLTextureParameterRegister<GLenum, GL_TEXTURE_MIN_FILTER, GL_LINEAR>(*this).getValue(minificationFilter);
-  else
-    return GLTextureParameterRegister<GLenum, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR>(*this).getValue(minificationFilter);
-}
-GLErrorFlags GLTextureObject::getSwizzleRed(GLenum& swizzleRed) const
-  {return GLTextureParameterRegister<GLenum, GL_TEXTURE_SWIZZLE_R, GL_RED>(*this).getValue(swizzleRed);}
-GLErrorFlags GLTextureObject::getSwizzleGreen(GLenum& swizzleGreen) const
-  {return GLTextureParameterRegister<GLenum, GL_TEXTURE_SWIZZLE_G, GL_GREEN>(*this).getValue(swizzleGreen);}
-GLErrorFlags GLTextureObject::getSwizzleBlue(GLenum& swizzleBlue) const
-  {return GLTextureParameterRegister<GLenum, GL_TEXTURE_SWIZZLE_B, GL_BLUE>(*this).getValue(swizzleBlue);}
-GLErrorFlags GLTextureObject::getSwizzleAlpha(GLenum& swizzleAlpha) const
-  {return GLTextureParameterRegister<GLenum, GL_TEXTURE_SWIZZLE_A, GL_ALPHA>(*this).getValue(swizzleAlpha);}
-GLErrorFlags GLTextureObject::getHorizontalWrapMode(GLenum& horizontalWrapMode) const
-{
-  if (target == GL_TEXTURE_RECTANGLE)
-    return GLTextureParameterRegister<GLenum, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE>(*this).getValue(horizontalWrapMode);
-  else
-    return GLTextureParameterRegister<GLenum, GL_TEXTURE_WRAP_S, GL_REPEAT>(*this).getValue(horizontalWrapMode);
-}
-GLErrorFlags GLTextureObject::getVerticalWrapMode(GLenum& verticalWrapMode) const
-{
-  if (target == GL_TEXTURE_RECTANGLE)
-    return GLTextureParameterRegister<GLenum, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE>(*this).getValue(verticalWrapMode);
-  else
-    return GLTextureParameterRegister<GLenum, GL_TEXTURE_WRAP_T, GL_REPEAT>(*this).getValue(verticalWrapMode);
-}
-GLErrorFlags GLTextureObject::getDepthWrapMode(GLenum& depthWrapMode) const
-{
-  if (target == GL_TEXTURE_RECTANGLE)
-    return GLTextureParameterRegister<GLenum, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE>(*this).getValue(depthWrapMode);
-  else
-    return GLTextureParameterRegister<GLenum, GL_TEXTURE_WRAP_R, GL_REPEAT>(*this).getValue(depthWrapMode);
-}
+  // todo glGetVertexAttrib(GL_VERTEX_ATTRIB_ARRAY_ENABLED) glVertexAttrib
 
-GLErrorFlags GLTextureObject::setBaseLevel(GLint baseLevel)
-  {return GLTextureParameterRegister<GLint, GL_TEXTURE_BASE_LEVEL>(*this).setValue(baseLevel);}
-GLErrorFlags GLTextureObject::setMaxLevel(GLint maxLevel)
-  {return GLTextureParameterRegister<GLint, GL_TEXTURE_MAX_LEVEL, 1000>(*this).setValue(maxLevel);}
+  GLErrorFlags draw(GLenum mode, GLint first, GLsizei count)
+  {
+    jassert(isValid());
+    GLScopedSetValue<GLuint> _(context.getActiveVertexArrayBind(), id);
+    context.flushPendingValues(); // draw depend on the whole state
+    glDrawArrays(mode, first, count);
+    jassertglsucceed(context);
+    return GLErrorFlags::succeed;
+  }
+
+  // indicesOffset: first index byte in the element array buffer, baseVertex: added to each index
+  // (sub-allocated meshes sharing the vertex array: GLBufferHeap allocation offset / vertex size).
+  GLErrorFlags drawElements(GLenum mode, GLsizei count, GLenum type, GLintptr indicesOffset, GLint baseVertex = 0)
+  {
+    jassert(isValid());
+    if (type != GL_UNSIGNED_BYTE && type != GL_UNSIGNED_SHORT && type != GL_UNSIGNED_INT)
+      {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+    GLScopedSetValue<GLuint> _(context.getActiveVertexArrayBind(), id);
+    context.flushPendingValues(); // draw depend on the whole state
+    if (baseVertex)
+      glDrawElementsBaseVertex(mode, count, type, reinterpret_cast<GLvoid*>(indicesOffset), baseVertex);
+    else
+      glDrawElements(mode, count, type, reinterpret_cast<const GLvoid*>(indicesOffset));
+    jassertglsucceed(context);
+    return GLErrorFlags::succeed;
+  }
 
-GLErrorFlags GLTextureObject::setCompareMode(GLenum compareMode)
-{
-  if (!isValidCompareMode(compareMode))
-    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
-  return GLTextureParameterRegister<GLenum, GL_TEXTURE_COMPARE_MODE, GL_NONE>(*this).setValue(compareMode);
-}
+protected:
+  // GLObject interface
+  virtual GLboolean isValidName(GLuint id) const
+    {return glIsVertexArray(id);}
+  virtual void deleteNames(GLuint id) const
+    {context.notifyVertexArrayDeletion(id); glDeleteVertexArrays(1, &id);}
+};
 
-GLErrorFlags GLTextureObject::setCompareFunction(GLenum compareFunction)
-  {return GLTextureParameterRegister<GLenum, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL>(*this).setValue(compareFunction);}
-GLErrorFlags GLTextureObject::setLevelOfDetailBias(GLfloat levelOfDetailBias)
-  {return GLTextureFloatParameterRegister<GL_TEXTURE_LOD_BIAS>(*this).setValue(levelOfDetailBias);}
-GLErrorFlags GLTextureObject::setLevelOfDetailMax(GLfloat levelOfDetailMax)
-  {return GLTextureFloatParameterRegister<GL_TEXTURE_MAX_LOD, 1000>(*this).setValue(levelOfDetailMax);}
-GLErrorFlags GLTextureObject::setLevelOfDetailMin(GLfloat levelOfDetailMin)
-  {return GLTextureFloatParameterRegister<GL_TEXTURE_MIN_LOD, -1000>(*this).setValue(levelOfDetailMin);}
-GLErrorFlags GLTextureObject::setMagnificationFilter(GLenum magnificationFilter)
-{
-  if (!isValidMagnificationFilter(magnificationFilter))
-    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
-  return GLTextureParameterRegister<GLenum, GL_TEXTURE_MAG_FILTER, GL_LINEAR>(*this).setValue(magnificationFilter);
-}
-GLErrorFlags GLTextureObject::setMinificationFilter(GLenum minificationFilter)
-{
-  if (!isValidMinificationFilter(minificationFilter))
-    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+//////////////////////////////////////////////////////////////////////////////
 
-  if (target == GL_TEXTURE_RECTANGLE)
-    return GLTextureParameterRegister<GLenum, GL_TEXTURE_MIN_FILTER, GL_LINEAR>(*this).setValue(minificationFilter); // TODO assert if mimapping filtering
-  else
-    return GLTextureParameterRegister<GLenum, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR>(*this).setValue(minificationFilter);
-}
-GLErrorFlags GLTextureObject::setSwizzleRed(GLenum swizzleRed)
-{
-  if (!isValidSwizzling(swizzleRed))
-    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
-  return GLTextureParameterRegister<GLenum, GL_TEXTURE_SWIZZLE_R, GL_RED>(*this).setValue(swizzleRed);
-}
-GLErrorFlags GLTextureObject::setSwizzleGreen(GLenum swizzleGreen)
-{
-  if (!isValidSwizzling(swizzleGreen))
-    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
-  return GLTextureParameterRegister<GLenum, GL_TEXTURE_SWIZZLE_G, GL_GREEN>(*this).setValue(swizzleGreen);
-}
-GLErrorFlags GLTextureObject::setSwizzleBlue(GLenum swizzleBlue)
-{
-  if (!isValidSwizzling(swizzleBlue))
-    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
-  return GLTextureParameterRegister<GLenum, GL_TEXTURE_SWIZZLE_B, GL_BLUE>(*this).setValue(swizzleBlue);
-}
-GLErrorFlags GLTextureObject::setSwizzleAlpha(GLenum swizzleAlpha)
-{
-  if (!isValidSwizzling(swizzleAlpha))
-    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
-  return GLTextureParameterRegister<GLenum, GL_TEXTURE_SWIZZLE_A, GL_ALPHA>(*this).setValue(swizzleAlpha);
-}
-GLErrorFlags GLTextureObject::setHorizontalWrapMode(GLenum horizontalWrapMode)
-{
-  if (!isValidWrappingMode(horizontalWrapMode))
-    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
-  if (target == GL_TEXTURE_RECTANGLE)
-    return GLTextureParameterRegister<GLenum, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE>(*this).setValue(horizontalWrapMode); // assert if repeat
-  else
-    return GLTextureParameterRegister<GLenum, GL_TEXTURE_WRAP_S, GL_REPEAT>(*this).setValue(horizontalWrapMode);
-}
-GLErrorFlags GLTextureObject::setVerticalWrapMode(GLenum verticalWrapMode)
+// GLDynamicBufferObject strategy, from the expected content update frequency
+enum GLUpdateFrequency
 {
-  if (!isValidWrappingMode(verticalWrapMode))
-    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
-  if (target == GL_TEXTURE_RECTANGLE)
-    return GLTextureParameterRegister<GLenum, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE>(*this).setValue(verticalWrapMode); // assert if repeat
-  else
-    return GLTextureParameterRegister<GLenum, GL_TEXTURE_WRAP_T, GL_REPEAT>(*this).setValue(verticalWrapMode);
-}
+  rareUpdates = 0,  // less than once per frame: one GL_DYNAMIC_DRAW buffer updated in place
+  perFrameUpdates,  // once per frame: backing buffers used round robin, the updated one is not read by in flight frames
+  perDrawUpdates    // several times per frame: one GL_STREAM_DRAW buffer orphaned before each update (the driver renames it)
+};
 
-GLErrorFlags GLTextureObject::setDepthWrapMode(GLenum depthWrapMode)
+// Whole content rewritten buffer which never makes the CPU wait for the GPU still reading the previous content.
+// Linked vertex array attributes follow the current backing buffer.
+class GLDynamicBufferObject
 {
-  if (!isValidWrappingMode(depthWrapMode))
-    {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
-  if (target == GL_TEXTURE_RECTANGLE)
-    return GLTextureParameterRegister<GLenum, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE>(*this).setValue(depthWrapMode); // assert if repeat
-  else
-    return GLTextureParameterRegister<GLenum, GL_TEXTURE_WRAP_R, GL_REPEAT>(*this).setValue(depthWrapMode);
-}
+public:
+  enum {maxNumBuffers = 4};
 
-//////////////////////////////////////////////////////////////////////////////
+  GLDynamicBufferObject(GLContext& context)
+    : context(context), frequency(rareUpdates), size(0), target(GL_ARRAY_BUFFER), current(0) {}
 
-template <class GLTexturePropertyType, GLenum propertyName>
-class GLTextureProperty : public GLProperty<GLTexturePropertyType>
-{
-public:
-  typedef GLTexturePropertyType GLType;
+  ~GLDynamicBufferObject()
+    {jassert(buffers.empty());} // call destroy before destruction
 
-  GLTextureProperty(const GLTextureObject& textureObject, GLint level)
-    : GLProperty<GLType>(textureObject.getContext()), textureObject(textureObject), level(level)
+  // numFramesInFlight: perFrameUpdates backing buffers count (frames the GPU can queue, swap chain included)
+  GLErrorFlags create(GLsizeiptr size, const GLvoid* data, GLUpdateFrequency frequency, size_t numFramesInFlight = 3, GLenum target = GL_ARRAY_BUFFER)
+  {
+    jassert(buffers.empty()); // overwritting existing: potential memory leak
+    if (size <= 0 || numFramesInFlight < 1 || numFramesInFlight > maxNumBuffers)
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    this->frequency = frequency;
+    this->size = size;
+    this->target = target;
+    current = 0;
+
+    const size_t numBuffers = frequency == perFrameUpdates ? numFramesInFlight : 1;
+    const GLenum usage = frequency == rareUpdates ? GL_DYNAMIC_DRAW : GL_STREAM_DRAW;
+    buffers.reserve(numBuffers);
+    for (size_t i = 0; i < numBuffers; ++i)
     {
-      jassert(level >= 0);
-      jassert(textureObject.isValid());
+      buffers.push_back(GLBufferObject(context));
+      const GLErrorFlags errorFlags = buffers.back().create(size, data, usage, target);
+      if (errorFlags.hasErrors())
+        {buffers.pop_back(); destroy(); return errorFlags;}
     }
+    return GLErrorFlags::succeed;
+  }
 
-  // Warning: possible OpenGL flush performance penalty.
-  virtual GLType getValue() const
+  void destroy()
   {
-    const GLenum target = textureObject.getTarget();
-    jassert(GLProperty<GLType>::context.isValidTextureBindingTarget(target));
-    GLScopedSetValue<GLuint> _(GLProperty<GLType>::context.getActiveTextureBind(target), textureObject.getId());
-    GLint intValue = 0;
-    glGetTexLevelParameteriv(target, level, propertyName, &intValue);
-    jassertglsucceed(GLProperty<GLType>::context);
-    jassert(intValue >= 0);
-    return static_cast<GLType>(intValue);
+    for (size_t i = 0; i < buffers.size(); ++i)
+      buffers[i].destroy();
+    buffers.clear();
+    links.clear();
   }
 
-  virtual GLErrorFlags getValue(GLType& param) const
+  // vertex array attribute reading the current backing buffer (see GLVertexArrayObject::linkAttributeToBuffer)
+  GLErrorFlags linkAttribute(GLVertexArrayObject& vertexArray, GLuint index, GLint numComponents, GLenum type, GLboolean normalized, GLintptr offset = 0)
   {
-    const GLenum target = textureObject.getTarget();
-    if (!GLProperty<GLType>::context.isValidTextureBindingTarget(target))
-      {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
-    GLProperty<GLType>::context.clearErrorFlags();
-    GLScopedSetValue<GLuint> _(GLProperty<GLType>::context.getActiveTextureBind(target), textureObject.getId());
-    GLErrorFlags errorFlags = _.getConstructionState();
-    GLint intValue = 0;
+    if (buffers.empty())
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
+    const AttributeLink link = {&vertexArray, index, numComponents, type, normalized, offset};
+    const GLErrorFlags errorFlags = relink(link);
     if (errorFlags.hasSucceed())
+      links.push_back(link);
+    return errorFlags;
+  }
+
+  // rewrite the whole content (size bytes of data)
+  GLErrorFlags update(const GLvoid* data)
+  {
+    if (!data)
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    if (buffers.empty())
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
+
+    GLErrorFlags errorFlags;
+    if (frequency == perDrawUpdates)
+      errorFlags = buffers[current].invalidate(target); // orphaning
+    else if (frequency == perFrameUpdates && buffers.size() > 1)
     {
-      glGetTexLevelParameteriv(target, level, propertyName, &intValue);
-      errorFlags = GLProperty<GLType>::context.popErrorFlags();
-      if (errorFlags.hasSucceed())
-      {
-        if (intValue < 0)
-          {jassertfalse; errorFlags = GLErrorFlags::invalidValueFlag;}
-      }
-      else
-        {jassertfalse;}
+      current = (current + 1) % buffers.size();
+      for (size_t i = 0; i < links.size(); ++i)
+        errorFlags.merge(relink(links[i]));
     }
-    param = static_cast<GLType>(intValue);
+    errorFlags.merge(buffers[current].set(size, data, 0, target));
     return errorFlags;
   }
 
+  // current backing buffer (changes on perFrameUpdates updates)
+  GLuint getId() const
+    {return buffers.empty() ? 0 : buffers[current].getId();}
+  GLsizeiptr getSize() const
+    {return size;}
+  GLUpdateFrequency getUpdateFrequency() const
+    {return frequency;}
+  size_t getNumBuffers() const
+    {return buffers.size();}
+
 private:
-   const GLTextureObject& textureObject;
-   const GLint level;
-};
+  struct AttributeLink
+  {
+    GLVertexArrayObject* vertexArray;
+    GLuint index;
+    GLint numComponents;
+    GLenum type;
+    GLboolean normalized;
+    GLintptr offset;
+  };
 
-// GLTextureObject
-GLsizei GLTextureObject::getWidth(GLint level) const
-  {return GLTextureProperty<GLsizei, GL_TEXTURE_WIDTH>(*this, level).getValue();}
-GLsizei GLTextureObject::getHeight(GLint level) const
-  {return GLTextureProperty<GLsizei, GL_TEXTURE_HEIGHT>(*this, level).getValue();}
-GLsizei GLTextureObject::getDepth(GLint level) const
-  {return GLTextureProperty<GLsizei, GL_TEXTURE_DEPTH>(*this, level).getValue();}
-GLsizei GLTextureObject::getNumSamplesPerTexel(GLint level) const
-  {return GLTextureProperty<GLsizei, GL_TEXTURE_SAMPLES>(*this, level).getValue();}
-GLint GLTextureObject::getInternalFormat(GLint level) const
-  {return GLTextureProperty<GLint, GL_TEXTURE_INTERNAL_FORMAT>(*this, level).getValue();}
-GLsizei GLTextureObject::getNumBitsForRed(GLint level) const
-  {return GLTextureProperty<GLsizei, GL_TEXTURE_RED_SIZE>(*this, level).getValue();}
-GLsizei GLTextureObject::getNumBitsForGreen(GLint level) const
-  {return GLTextureProperty<GLsizei, GL_TEXTURE_GREEN_SIZE>(*this, level).getValue();}
-GLsizei GLTextureObject::getNumBitsForBlue(GLint level) const
-  {return GLTextureProperty<GLsizei, GL_TEXTURE_BLUE_SIZE>(*this, level).getValue();}
-GLsizei GLTextureObject::getNumBitsForAlpha(GLint level) const
-  {return GLTextureProperty<GLsizei, GL_TEXTURE_ALPHA_SIZE>(*this, level).getValue();}
-GLsizei GLTextureObject::getNumBitsForDepth(GLint level) const
-  {return GLTextureProperty<GLsizei, GL_TEXTURE_DEPTH_SIZE>(*this, level).getValue();}
-GLsizei GLTextureObject::getNumBitsForStencil(GLint level) const
-  {return GLTextureProperty<GLsizei, GL_TEXTURE_STENCIL_SIZE>(*this, level).getValue();}
-GLboolean GLTextureObject::isCompressed(GLint level) const
-  {return GLTextureProperty<GLboolean, GL_TEXTURE_COMPRESSED>(*this, level).getValue();}
-GLsizei GLTextureObject::getCompressedImageSize(GLint level) const
-  {return GLTextureProperty<GLsizei, GL_TEXTURE_COMPRESSED_IMAGE_SIZE>(*this, level).getValue();}
-// todo add TEXTURE_FIXED_SAMPLE_LOCATIONS, TEXTURE_BUFFER_DATA_STORE_BINDING...
+  GLErrorFlags relink(const AttributeLink& link)
+    {return link.vertexArray->linkAttributeToBuffer(link.index, link.numComponents, link.type, link.normalized, buffers[current].getId(), link.offset);}
+
+  GLContext& context;
+  std::vector<GLBufferObject> buffers;
+  std::vector<AttributeLink> links;
+  GLUpdateFrequency frequency;
+  GLsizeiptr size;
+  GLenum target;
+  size_t current;
+};
 
 //////////////////////////////////////////////////////////////////////////////
 
-class GLBufferObject : public GLObject
+// Buddy sub-allocator carving meshes out of a few large buffer objects (pages): all the meshes of a page share its
+// vertex array (drawElements baseVertex or draw first = allocation offset / vertex size).
+// Blocks are power of two multiples of minBlockSize, split on allocate and merged back with their free buddy on free.
+// Handles are stable: defragment moves blocks between pages with GPU side copies and updates their allocation.
+// Freed handles are recycled with a new generation: a stale handle is detected instead of aliasing a newer allocation.
+class GLBufferHeap
 {
 public:
-  GLBufferObject(GLContext& context)
-    : GLObject(context) {}
-
-  // Warning: possible OpenGL flush performance penalty.
-  GLErrorFlags create(GLsizeiptr size, const GLvoid* data, GLenum usage, GLenum temporaryTarget = GL_ARRAY_BUFFER)
+  struct Allocation
   {
-    jassert(!id); // overwritting existing: potential memory leak
-    jassert(size >= 0);
-    jassert(context.isValidBufferBindingTarget(temporaryTarget) && isValidUsage(usage));
-    glGenBuffers(1, &id);
-    jassertglsucceed(context);
-    jassert(id);
+    Allocation()
+      : page(0), offset(0), size(0) {}
 
-    GLScopedSetValue<GLuint> _(context.getActiveBufferBind(temporaryTarget), id);
-    context.clearErrorFlags(); // clear previous error ensure next popContextErrorFlags concern glBufferData
-    glBufferData(temporaryTarget, size, data, usage);
-    const GLErrorFlags errorFlags = context.popErrorFlags();
-    if (errorFlags.hasErrors())
-    {
-      _.cancelScopedValue(); // unbind before deletion seem's to be cleaner
-      destroy();
-    }
-    return errorFlags;
-  }
+    size_t page;      // see getPage
+    GLintptr offset;  // in the page, multiple of the allocation alignment
+    GLsizeiptr size;
+  };
 
-  GLErrorFlags set(GLsizeiptr size, const GLvoid* data, GLintptr offset = 0, GLenum temporaryTarget = GL_ARRAY_BUFFER)
+  GLBufferHeap(GLContext& context)
+    : context(context), pageSize(0), minBlockSize(0), numOrders(0), usage(GL_STATIC_DRAW), target(GL_ARRAY_BUFFER) {}
+
+  ~GLBufferHeap()
+    {jassert(pages.empty());} // call destroy before destruction
+
+  // pageSize and minBlockSize must be powers of two. Pages are created on demand, maxNumPages at most.
+  GLErrorFlags create(GLsizeiptr pageSize, GLsizeiptr minBlockSize = 256, size_t maxNumPages = 16, GLenum usage = GL_STATIC_DRAW, GLenum target = GL_ARRAY_BUFFER)
   {
-    if (offset < 0 || size < 0)
+    jassert(pages.empty()); // overwritting existing: potential memory leak
+    if (!isPowerOfTwo(pageSize) || !isPowerOfTwo(minBlockSize) || minBlockSize > pageSize || !maxNumPages)
       {jassertfalse; return GLErrorFlags::invalidValueFlag;}
-    if (!id)
-      {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
-    if (!context.isValidBufferBindingTarget(temporaryTarget))
+    if (!context.isValidBufferBindingTarget(target))
       {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
-
-    GLScopedSetValue<GLuint> _(context.getActiveBufferBind(temporaryTarget), id);
-    glBufferSubData(temporaryTarget, 0, size, data);
-    jassertglsucceed(context); // invalidValueFlag if offset + size extends beyond the buffer object's allocated data store
-                      // invalidOperationFlag if the buffer object being updated is mapped.
+    this->pageSize = pageSize;
+    this->minBlockSize = minBlockSize;
+    this->usage = usage;
+    this->target = target;
+    for (numOrders = 1; getBlockSize(numOrders - 1) < pageSize; ++numOrders) {}
+    pages.reserve(maxNumPages);
+    for (size_t i = 0; i < maxNumPages; ++i)
+      pages.push_back(Page(context));
     return GLErrorFlags::succeed;
   }
 
-  GLErrorFlags map(GLenum access, void** data, GLenum temporaryTarget = GL_ARRAY_BUFFER)
+  void destroy()
   {
-    if (!data || !isValidAccess(access) || !context.isValidBufferBindingTarget(temporaryTarget))
-      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    for (size_t i = 0; i < pages.size(); ++i)
+      if (pages[i].buffer.getId())
+        pages[i].buffer.destroy();
+    pages.clear();
+    blocks.clear();
+    freeSlots.clear();
+  }
 
-    GLScopedSetValue<GLuint> _(context.getActiveBufferBind(temporaryTarget), id);
-    *data = glMapBuffer(temporaryTarget, access);
-    if (!*data)
-    { // in this error case only, we could have performance penalty
-      const GLErrorFlags errorFlags = context.popErrorFlags();
-      jassert(errorFlags.hasErrors()); // hum hum: openGL say that if glMapBuffer return NULL, an error is generated
-      // invalidOperationFlag: buffer object is already mapped
-      // outOfVideoMemoryFlag: can be a virtual memory problem
+  // alignment: any positive value (vertex size for baseVertex draws, 4 for indices...).
+  // data (optional) is uploaded with glBufferSubData: prefer a GLStagingBuffer upload when the page is in use by the GPU.
+  // Return outOfVideoMemoryFlag when no page can hold the allocation anymore.
+  GLErrorFlags allocate(GLsizeiptr size, GLsizeiptr alignment, GLuint& handle, const GLvoid* data = NULL)
+  {
+    handle = 0;
+    if (size <= 0 || alignment <= 0)
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    if (pages.empty())
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // not created
+
+    // blocks are aligned on minBlockSize (at least): other alignments are padded
+    const GLsizeiptr paddedSize = size + (minBlockSize % alignment ? alignment - 1 : 0);
+    size_t order = 0;
+    while (order < numOrders && getBlockSize(order) < paddedSize)
+      ++order;
+    if (order == numOrders)
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;} // larger than a page
+
+    Block block;
+    GLErrorFlags errorFlags = allocateBlock(order, pages.size(), true, block.allocation.page, block.blockOffset);
+    if (errorFlags.hasErrors())
       return errorFlags;
+    block.order = order;
+    block.alignment = alignment;
+    block.allocation.offset = alignOffset(block.blockOffset, alignment);
+    block.allocation.size = size;
+    block.used = true;
+
+    size_t slot;
+    if (freeSlots.empty())
+    {
+      if (blocks.size() == maxNumSlots)
+        {freeBlock(block.allocation.page, block.blockOffset, block.order); jassertfalse; return GLErrorFlags::invalidOperationFlag;} // too many allocations
+      block.generation = 0;
+      slot = blocks.size();
+      blocks.push_back(block);
     }
-    return GLErrorFlags::succeed;
+    else
+    {
+      slot = freeSlots.back();
+      freeSlots.pop_back();
+      block.generation = blocks[slot].generation;
+      blocks[slot] = block;
+    }
+    if (data)
+    {
+      errorFlags = pages[block.allocation.page].buffer.set(size, data, block.allocation.offset, target);
+      if (errorFlags.hasErrors())
+        {releaseSlot(slot); return errorFlags;}
+    }
+    handle = makeHandle(slot, block.generation);
+    return errorFlags;
   }
 
-  GLErrorFlags unmap(GLenum temporaryTarget = GL_ARRAY_BUFFER)
+  GLErrorFlags free(GLuint handle)
   {
-    if (!context.isValidBufferBindingTarget(temporaryTarget))
-      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    if (!isValidHandle(handle))
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;} // double free or stale handle
+    releaseSlot(getHandleSlot(handle));
+    return GLErrorFlags::succeed;
+  }
 
-    GLScopedSetValue<GLuint> _(context.getActiveBufferBind(temporaryTarget), id);
-    if (glUnmapBuffer(temporaryTarget))
-      return GLErrorFlags::succeed;
-    else
+  // Evacuate the least used pages into the other ones (GPU side copies, no CPU stall) and delete the emptied pages.
+  // Moved allocations change: read them again (getAllocation) before the next draws. maxNumMoves bounds the frame cost.
+  GLErrorFlags defragment(size_t& numMoves, size_t maxNumMoves = size_t(-1))
+  {
+    numMoves = 0;
+    for (;;)
     {
-      const GLErrorFlags errorFlags = context.popErrorFlags();
-      jassert(errorFlags.hasErrors()); // hum hum: openGL say that if glMapBuffer return NULL, an error is generated
-      // invalidOperationFlag: buffer object is not currently mapped
-      return errorFlags;
+      // least used page whose content fits in the other pages free space
+      size_t source = pages.size();
+      GLsizeiptr freeSize = 0;
+      for (size_t i = 0; i < pages.size(); ++i)
+        if (pages[i].buffer.getId())
+        {
+          freeSize += pageSize - pages[i].usedSize;
+          if (pages[i].usedSize && (source == pages.size() || pages[i].usedSize < pages[source].usedSize))
+            source = i;
+        }
+      if (source == pages.size() || freeSize - (pageSize - pages[source].usedSize) < pages[source].usedSize)
+        break;
+
+      for (size_t i = 0; i < blocks.size() && pages[source].usedSize; ++i)
+      {
+        Block& block = blocks[i];
+        if (!block.used || block.allocation.page != source)
+          continue;
+        if (numMoves == maxNumMoves)
+          return releaseEmptyPages();
+        size_t page;
+        GLintptr blockOffset;
+        if (allocateBlock(block.order, source, false, page, blockOffset).hasErrors())
+          return releaseEmptyPages(); // free space too fragmented
+        const GLintptr offset = alignOffset(blockOffset, block.alignment);
+        const GLErrorFlags errorFlags = pages[page].buffer.copyFrom(pages[source].buffer, block.allocation.offset, offset, block.allocation.size);
+        if (errorFlags.hasErrors())
+          {freeBlock(page, blockOffset, block.order); return errorFlags;}
+        freeBlock(source, block.blockOffset, block.order);
+        block.allocation.page = page;
+        block.allocation.offset = offset;
+        block.blockOffset = blockOffset;
+        ++numMoves;
+      }
+      releaseEmptyPages();
     }
+    return releaseEmptyPages();
   }
 
-  // TODO glGetBufferPointerv glGetBufferParameter
+  const Allocation& getAllocation(GLuint handle) const
+    {jassert(isValidHandle(handle)); return blocks[getHandleSlot(handle)].allocation;}
 
-protected:
-  // GLObject interface
-  virtual GLboolean isValidName(GLuint id) const
-    {return glIsBuffer(id);}
-  virtual void deleteNames(GLuint id) const
-    {glDeleteBuffers(1, &id);}
+  // page buffer object (id 0 if not created yet)
+  GLBufferObject& getPage(size_t page)
+    {jassert(page < pages.size()); return pages[page].buffer;}
+  GLuint getPageId(size_t page) const
+    {jassert(page < pages.size()); return pages[page].buffer.getId();}
+  size_t getMaxNumPages() const
+    {return pages.size();}
+  GLsizeiptr getPageSize() const
+    {return pageSize;}
+
+  // bytes in used blocks (alignment padding and block rounding included)
+  GLsizeiptr getUsedSize() const
+  {
+    GLsizeiptr usedSize = 0;
+    for (size_t i = 0; i < pages.size(); ++i)
+      usedSize += pages[i].usedSize;
+    return usedSize;
+  }
+
+  size_t getNumAllocations() const
+    {return blocks.size() - freeSlots.size();}
 
 private:
-  static bool isValidUsage(GLenum usage)
+  struct Page
   {
-    switch (usage)
+    Page(GLContext& context)
+      : buffer(context), usedSize(0) {}
+
+    GLBufferObject buffer;
+    std::vector< std::set<GLintptr> > freeBlocks; // block offsets by order
+    GLsizeiptr usedSize;
+  };
+
+  struct Block
+  {
+    Allocation allocation;
+    GLintptr blockOffset;
+    size_t order;
+    GLsizeiptr alignment;
+    bool used;
+    GLuint generation; // incremented on free
+  };
+
+  // handle = generation in the high bits, slot + 1 in the low bits (0 is never a valid handle)
+  enum {numSlotBits = 20};
+  static const size_t maxNumSlots = (size_t(1) << numSlotBits) - 1;
+  static const GLuint generationMask = GLuint(-1) >> numSlotBits;
+
+  static GLuint makeHandle(size_t slot, GLuint generation)
+    {return (generation << numSlotBits) | static_cast<GLuint>(slot + 1);}
+  static size_t getHandleSlot(GLuint handle)
+    {return (handle & ((GLuint(1) << numSlotBits) - 1)) - 1;}
+  static GLuint getHandleGeneration(GLuint handle)
+    {return handle >> numSlotBits;}
+
+  static bool isPowerOfTwo(GLsizeiptr value)
+    {return value > 0 && !(value & (value - 1));}
+
+  static GLintptr alignOffset(GLintptr offset, GLsizeiptr alignment)
+    {return (offset + alignment - 1) / alignment * alignment;}
+
+  GLsizeiptr getBlockSize(size_t order) const
+    {return minBlockSize << order;}
+
+  bool isValidHandle(GLuint handle) const
+  {
+    const size_t slot = getHandleSlot(handle);
+    return slot < blocks.size() && blocks[slot].used && blocks[slot].generation == getHandleGeneration(handle);
+  }
+
+  void releaseSlot(size_t slot)
+  {
+    Block& block = blocks[slot];
+    freeBlock(block.allocation.page, block.blockOffset, block.order);
+    block.used = false;
+    block.generation = (block.generation + 1) & generationMask;
+    freeSlots.push_back(slot);
+  }
+
+  // best fit: the smallest free block large enough, in the first pages first (they are kept the most used)
+  GLErrorFlags allocateBlock(size_t order, size_t excludedPage, bool canCreatePage, size_t& page, GLintptr& blockOffset)
+  {
+    size_t foundOrder = numOrders;
+    for (size_t i = 0; i < pages.size() && foundOrder != order; ++i)
+      if (i != excludedPage && pages[i].buffer.getId())
+        for (size_t j = order; j < foundOrder; ++j)
+          if (!pages[i].freeBlocks[j].empty())
+            {page = i; foundOrder = j; break;}
+
+    if (foundOrder == numOrders)
     {
-    case GL_STREAM_DRAW:
-    case GL_STREAM_READ:
-    case GL_STREAM_COPY:
-    case GL_STATIC_DRAW:
-    case GL_STATIC_READ:
-    case GL_STATIC_COPY:
-    case GL_DYNAMIC_DRAW:
-    case GL_DYNAMIC_READ:
-    case GL_DYNAMIC_COPY:
-      return true;
-    default:
-      return false;
+      if (!canCreatePage)
+        return GLErrorFlags::outOfVideoMemoryFlag;
+      for (page = 0; page < pages.size() && pages[page].buffer.getId(); ++page) {}
+      if (page == pages.size())
+        return GLErrorFlags::outOfVideoMemoryFlag; // maxNumPages reached
+      const GLErrorFlags errorFlags = pages[page].buffer.create(pageSize, NULL, usage, target);
+      if (errorFlags.hasErrors())
+        return errorFlags;
+      foundOrder = numOrders - 1;
+      pages[page].freeBlocks.assign(numOrders, std::set<GLintptr>());
+      pages[page].freeBlocks[foundOrder].insert(0);
+      pages[page].usedSize = 0;
+    }
+
+    std::set<GLintptr>& freeBlocks = pages[page].freeBlocks[foundOrder];
+    blockOffset = *freeBlocks.begin(); // lowest offset: keep the page content packed
+    freeBlocks.erase(freeBlocks.begin());
+    for (size_t j = foundOrder; j > order; --j) // split: upper halves become free
+      pages[page].freeBlocks[j - 1].insert(blockOffset + getBlockSize(j - 1));
+    pages[page].usedSize += getBlockSize(order);
+    return GLErrorFlags::succeed;
+  }
+
+  void freeBlock(size_t page, GLintptr blockOffset, size_t order)
+  {
+    Page& freedPage = pages[page];
+    freedPage.usedSize -= getBlockSize(order);
+    for (; order + 1 < numOrders; ++order) // merge with the free buddy
+    {
+      std::set<GLintptr>& freeBlocks = freedPage.freeBlocks[order];
+      const std::set<GLintptr>::iterator buddy = freeBlocks.find(blockOffset ^ getBlockSize(order));
+      if (buddy == freeBlocks.end())
+        break;
+      freeBlocks.erase(buddy);
+      blockOffset &= ~static_cast<GLintptr>(getBlockSize(order));
     }
+    freedPage.freeBlocks[order].insert(blockOffset);
+  }
+
+  GLErrorFlags releaseEmptyPages()
+  {
+    for (size_t i = 0; i < pages.size(); ++i)
+      if (pages[i].buffer.getId() && !pages[i].usedSize)
+      {
+        pages[i].buffer.destroy();
+        pages[i].freeBlocks.clear();
+      }
+    return GLErrorFlags::succeed;
   }
 
-  static bool isValidAccess(GLenum access)
-    {return access == GL_READ_ONLY || access == GL_WRITE_ONLY || access == GL_READ_WRITE;}
+  GLContext& context;
+  std::vector<Page> pages;
+  std::vector<Block> blocks; // by handle slot
+  std::vector<size_t> freeSlots;
+  GLsizeiptr pageSize;
+  GLsizeiptr minBlockSize;
+  size_t numOrders;
+  GLenum usage;
+  GLenum target;
 };
 
 //////////////////////////////////////////////////////////////////////////////
 
-class GLVertexArrayObject : public GLObject
+// Staging uploads: data are written in a mapped staging buffer and copied into the destination on the GPU side,
+// the CPU never waits for the GPU to release the destination (GL_STATIC_DRAW meshes, GLBufferHeap pages...).
+// The staging buffer is used linearly with unsynchronized maps and orphaned when it wraps (pending copies keep the old storage).
+class GLStagingBuffer
 {
 public:
-  GLVertexArrayObject(GLContext& context)
-    : GLObject(context) {}
+  GLStagingBuffer(GLContext& context)
+    : buffer(context), size(0), cursor(0) {}
 
-  GLErrorFlags create()
-  {
-    jassert(!id); // overwritting existing: potential memory leak
-    glGenVertexArrays(1, &id);
-    jassertglsucceed(context);
-    jassert(id);
+  ~GLStagingBuffer()
+    {jassert(!buffer.getId());} // call destroy before destruction
 
-    GLScopedSetValue<GLuint> _(context.getActiveVertexArrayBind(), id);
-    jassertglsucceed(context);
-    // todo others user friendly things before leaving
-    return context.popErrorFlags();
+  GLErrorFlags create(GLsizeiptr size)
+  {
+    if (size <= 0)
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    this->size = size;
+    cursor = 0;
+    return buffer.create(size, NULL, GL_STREAM_DRAW);
   }
 
-  static bool isValidComponentPerVertexAttributeCount(GLint count)
-    {return (count >= 1 && count <= 4) || (count == GL_BGRA);}
+  void destroy()
+    {buffer.destroy();}
 
-  GLErrorFlags linkAttributeToBuffer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLuint bufferId)
+  // uploads larger than the staging buffer are split in several copies
+  GLErrorFlags upload(GLBufferObject& destination, GLintptr destinationOffset, GLsizeiptr uploadSize, const GLvoid* data)
   {
-    // todo check type
-    if (!context.isValidVertexAttributeIndex(index) || !isValidComponentPerVertexAttributeCount(size) || !bufferId)
+    if (destinationOffset < 0 || uploadSize < 0 || (uploadSize && !data))
       {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    if (!buffer.getId())
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // not created
 
-    GLScopedSetValue<GLuint> _(context.getActiveVertexArrayBind(), id);
-    glEnableVertexAttribArray(index);
-    jassertglsucceed(context);
+    const GLubyte* bytes = static_cast<const GLubyte*>(data);
+    while (uploadSize)
+    {
+      const GLsizeiptr chunkSize = std::min(uploadSize, size);
+      GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+      if (cursor + chunkSize > size)
+        {cursor = 0; access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;} // wrap: orphaning
 
-    GLScopedSetValue<GLuint> __(context.getActiveBufferBind(GL_ARRAY_BUFFER), bufferId);
-    glVertexAttribPointer(index, size, type, normalized, 0, 0);
-    jassertglsucceed(context);
+      void* staging;
+      GLErrorFlags errorFlags = buffer.mapRange(cursor, chunkSize, access, &staging);
+      if (errorFlags.hasErrors())
+        return errorFlags;
+      memcpy(staging, bytes, chunkSize);
+      errorFlags = buffer.unmap();
+      if (errorFlags.hasErrors())
+        return errorFlags;
+      errorFlags = destination.copyFrom(buffer, cursor, destinationOffset, chunkSize);
+      if (errorFlags.hasErrors())
+        return errorFlags;
+      destination.updateHostMirror(destinationOffset, chunkSize, bytes);
 
+      cursor += chunkSize;
+      bytes += chunkSize;
+      destinationOffset += chunkSize;
+      uploadSize -= chunkSize;
+    }
     return GLErrorFlags::succeed;
   }
 
-  GLErrorFlags unLinkAttribute(GLuint index)
+  // GLBufferHeap allocation upload
+  GLErrorFlags upload(GLBufferHeap& heap, GLuint handle, const GLvoid* data)
   {
-    if (!context.isValidVertexAttributeIndex(index))
-      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
-    glDisableVertexAttribArray(index);
-    jassertglsucceed(context);
-    return GLErrorFlags::succeed;
+    const GLBufferHeap::Allocation& allocation = heap.getAllocation(handle);
+    return upload(heap.getPage(allocation.page), allocation.offset, allocation.size, data);
   }
 
-  // todo glGetVertexAttrib(GL_VERTEX_ATTRIB_ARRAY_ENABLED) glVertexAttrib
-
-  GLErrorFlags draw(GLenum mode, GLint first, GLsizei count)
-  {
-    jassert(isValid());
-    GLScopedSetValue<GLuint> _(context.getActiveVertexArrayBind(), id);
-    glDrawArrays(mode, first, count);
-    jassertglsucceed(context);
-    return GLErrorFlags::succeed;
-  }
+  GLuint getId() const
+    {return buffer.getId();}
+  GLsizeiptr getSize() const
+    {return size;}
 
-protected:
-  // GLObject interface
-  virtual GLboolean isValidName(GLuint id) const
-    {return glIsVertexArray(id);}
-  virtual void deleteNames(GLuint id) const
-    {glDeleteVertexArrays(1, &id);}
+private:
+  GLBufferObject buffer;
+  GLsizeiptr size;
+  GLintptr cursor; // next free byte
 };
 
 //////////////////////////////////////////////////////////////////////////////
@@ -2907,9 +6791,9 @@ public:
       {jassertfalse; return GLErrorFlags::invalidValueFlag;}
 
     jassert(isValid());
-    context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(context, resourceErrorCheck);
     glGetShaderInfoLog(id, maxLength, length, infoLog);
-    const GLErrorFlags errorFlags = context.popErrorFlags();
+    const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, resourceErrorCheck);
     jassert(errorFlags.hasSucceed());
     return errorFlags;
   }
@@ -2935,9 +6819,9 @@ public:
   virtual GLErrorFlags getValue(GLType& param) const
   {
     GLint intValue = 0;
-    GLProperty<GLType>::context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(GLProperty<GLType>::context, resourceErrorCheck);
     glGetShaderiv(shaderObject.getId(), propertyName, &intValue);
-    GLErrorFlags errorFlags =  GLProperty<GLType>::context.popErrorFlags();
+    GLErrorFlags errorFlags =  DOCGL_POP_ERROR_FLAGS(GLProperty<GLType>::context, resourceErrorCheck);
     if (errorFlags.hasSucceed())
     {
       if (intValue < 0)
@@ -2973,11 +6857,151 @@ class GLProgramUniformRegister;
 template <GLint numRows, GLint numColumns>
 class GLProgramUniformMatrixRegister;
 
+// last value sent (or to send) to an uniform location
+struct GLUniformShadow
+{
+  typedef void (*SendFunction)(GLint location, GLsizei count, GLboolean transpose, const void* value);
+
+  GLUniformShadow()
+    : send(NULL), count(0), transpose(GL_FALSE), dirty(false) {}
+
+  bool isSame(SendFunction otherSend, GLsizei otherCount, GLboolean otherTranspose, const void* otherValue, size_t numBytes) const
+  {
+    return send == otherSend && count == otherCount && transpose == otherTranspose
+      && value.size() == numBytes && !memcmp(&value[0], otherValue, numBytes);
+  }
+
+  SendFunction send; // NULL: unknown value
+  GLsizei count;
+  GLboolean transpose;
+  bool dirty;        // modified during uniforms batch, not sent yet
+  std::vector<GLubyte> value;
+};
+
+// active program variable, enumerated once at link time
+struct GLProgramVariable
+{
+  enum Kind
+  {
+    uniformKind = 0,
+    attributeKind,
+    uniformBlockKind,
+    subroutineKind,
+    subroutineUniformKind,
+  };
+
+  std::string name;
+  GLuint hash;
+  GLenum kind;
+  GLenum shaderType; // subroutines only, 0 otherwise
+  GLint location;    // index for uniform blocks and subroutines
+  GLenum type;       // 0 for uniform blocks and subroutines
+  GLint size;        // array size, data size in bytes for uniform blocks
+  GLint offset;      // offset in uniform block, -1 otherwise
+  GLint blockIndex;  // -1 if not in a uniform block
+};
+
+// flat table of active program variables sorted by name hash: lookups do not reach OpenGL.
+class GLProgramReflection
+{
+public:
+  GLProgramReflection()
+    : built(false) {}
+
+  void clear()
+    {variables.clear(); uniformIndices.clear(); built = false;}
+
+  void add(GLenum kind, GLenum shaderType, const GLchar* name, GLint location, GLenum type, GLint size, GLint offset, GLint blockIndex)
+  {
+    jassert(!built);
+    GLProgramVariable variable;
+    variable.name = name;
+    variable.hash = hashName(kind, shaderType, name);
+    variable.kind = kind;
+    variable.shaderType = shaderType;
+    variable.location = location;
+    variable.type = type;
+    variable.size = size;
+    variable.offset = offset;
+    variable.blockIndex = blockIndex;
+    variables.push_back(variable);
+
+    // arrays are reported as "name[0]" but may be looked up as "name"
+    const size_t length = variable.name.size();
+    if (length > 3 && !variable.name.compare(length - 3, 3, "[0]"))
+    {
+      variable.name.resize(length - 3);
+      variable.hash = hashName(kind, shaderType, variable.name.c_str());
+      variables.push_back(variable);
+    }
+  }
+
+  void build()
+  {
+    std::sort(variables.begin(), variables.end(), isLowerHash);
+    uniformIndices.clear();
+    for (size_t i = 0; i < variables.size(); ++i)
+    {
+      const GLProgramVariable& variable = variables[i];
+      if (variable.kind != GLProgramVariable::uniformKind || variable.location < 0)
+        continue;
+      if (static_cast<size_t>(variable.location) >= uniformIndices.size())
+        uniformIndices.resize(variable.location + 1, -1);
+      uniformIndices[variable.location] = static_cast<GLint>(i);
+    }
+    built = true;
+  }
+
+  bool isBuilt() const
+    {return built;}
+
+  const GLProgramVariable* find(GLenum kind, GLenum shaderType, const GLchar* name) const
+  {
+    GLProgramVariable key;
+    key.hash = hashName(kind, shaderType, name);
+    std::vector<GLProgramVariable>::const_iterator it = std::lower_bound(variables.begin(), variables.end(), key, isLowerHash);
+    for (; it != variables.end() && it->hash == key.hash; ++it)
+      if (it->kind == kind && it->shaderType == shaderType && it->name == name)
+        return &*it;
+    return NULL;
+  }
+
+  // NULL for unknown locations (array elements other than the first one).
+  const GLProgramVariable* findUniform(GLint location) const
+  {
+    if (location < 0 || static_cast<size_t>(location) >= uniformIndices.size() || uniformIndices[location] < 0)
+      return NULL;
+    return &variables[uniformIndices[location]];
+  }
+
+  size_t getNumVariables() const
+    {return variables.size();}
+  const GLProgramVariable& getVariable(size_t index) const
+    {return variables[index];}
+
+  // FNV-1a
+  static GLuint hashName(GLenum kind, GLenum shaderType, const GLchar* name)
+  {
+    GLuint hash = 2166136261u ^ (kind * 16777619u) ^ shaderType;
+    for (; *name; ++name)
+      hash = (hash ^ static_cast<GLubyte>(*name)) * 16777619u;
+    return hash;
+  }
+
+private:
+  std::vector<GLProgramVariable> variables;
+  std::vector<GLint> uniformIndices; // location to variables index, -1 if unknown
+  bool built;
+
+  static bool isLowerHash(const GLProgramVariable& first, const GLProgramVariable& second)
+    {return first.hash < second.hash;}
+};
+
 class GLProgramObject : public GLObject, public GLBuildableInterface, public GLValidableInterface
 {
 public:
   GLProgramObject(GLContext& context)
-    : GLObject(context) {}
+    : GLObject(context), uniformsBatch(false), maxShadowedUniformLocation(-1) {}
 
   GLErrorFlags create()
   {
@@ -2987,12 +7011,21 @@ public:
     if (!id)
       {jassertfalse; return GLErrorFlags::invalidValueFlag;}
     jassertglsucceed(context);
+    forgetLinkedState();
     return GLErrorFlags::succeed;
   };
 
+  // delete the OpenGL object and forget its uniforms shadows and reflection
+  void destroy()
+    {GLObject::destroy(); forgetLinkedState();}
+
+  // adopt another OpenGL object: uniforms are not shadowed until its next build
+  void setId(GLuint id)
+    {GLObject::setId(id); forgetLinkedState();}
+
   GLErrorFlags createSeparable(GLenum shaderType, GLsizei count, const GLchar** source)
   {
-    if (!GLEW_ARB_separate_shader_objects)
+    if (!context.hasCapability(separateShaderObjectsCapability))
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // // this is not an OpenGL3.3 feature (ARB extension included in OpenGL 4.1)
     jassert(!id); // overwritting existing: potential memory leak
     if (count < 0)
@@ -3002,7 +7035,8 @@ public:
     id = glCreateShaderProgramv(shaderType, count, source);
     jassertglsucceed(context);
     jassert(id);
-    return GLErrorFlags::succeed;
+    invalidateUniforms();
+    return buildReflection(); // already linked
   }
 
   GLErrorFlags linkToShader(GLuint shader)
@@ -3049,7 +7083,8 @@ public:
     jassert(isValid());
     glLinkProgram(id);
     jassertglsucceed(context);
-    return GLErrorFlags::succeed;
+    invalidateUniforms(); // link reset uniforms to their default values
+    return buildReflection();
   }
 
   virtual GLErrorFlags validate()
@@ -3062,22 +7097,71 @@ public:
     return GLErrorFlags::succeed;
   }
 
+  // uniforms are shadowed per location: setting the value already sent does not reach OpenGL.
   template<typename GLType>
   GLErrorFlags setUniformValue(GLint location, GLint size, GLsizei count, GLType value)
   {
+    const GLProgramVariable* variable = reflection.findUniform(location);
+    if (variable && (!isCompatibleUniformType(variable->type, getUniformComponentType(value), size) || count > variable->size))
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // type or array size mismatch
+    const size_t numBytes = size * count * sizeof(*value);
     switch (size)
     {
-    case 1: return GLProgramUniformRegister<GLType, 1>(*this, location, count).setValue(value);
-    case 2: return GLProgramUniformRegister<GLType, 2>(*this, location, count).setValue(value);
-    case 3: return GLProgramUniformRegister<GLType, 3>(*this, location, count).setValue(value);
-    case 4: return GLProgramUniformRegister<GLType, 4>(*this, location, count).setValue(value);
+    case 1: return setShadowedUniform(location, count, GL_FALSE, value, numBytes, &GLProgramUniformRegister<GLType, 1>::sendValue);
+    case 2: return setShadowedUniform(location, count, GL_FALSE, value, numBytes, &GLProgramUniformRegister<GLType, 2>::sendValue);
+    case 3: return setShadowedUniform(location, count, GL_FALSE, value, numBytes, &GLProgramUniformRegister<GLType, 3>::sendValue);
+    case 4: return setShadowedUniform(location, count, GL_FALSE, value, numBytes, &GLProgramUniformRegister<GLType, 4>::sendValue);
     default: jassertfalse; return GLErrorFlags::invalidValueFlag;
     }
   }
 
   template<GLint numRows, GLint numColumns, typename GLType>
   GLErrorFlags setUniformMatrix(GLint location, GLsizei count, GLboolean transpose, const GLType& value)
-    {return GLProgramUniformMatrixRegister<numRows, numColumns>(*this, location, count, transpose).setValue(value);}
+  {
+    if (!GLProgramUniformMatrixRegister<numRows, numColumns>::isValidSize())
+      {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+    const GLProgramVariable* variable = reflection.findUniform(location);
+    if (variable && (variable->type != getUniformMatrixType(numRows, numColumns) || count > variable->size))
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // type or array size mismatch
+    const size_t numBytes = numRows * numColumns * count * sizeof(GLfloat);
+    return setShadowedUniform(location, count, transpose, value, numBytes, &GLProgramUniformMatrixRegister<numRows, numColumns>::sendValue);
+  }
+
+  // uniforms batch: between begin and end, modified uniforms are only recorded.
+  // endUniformsBatch send all of them with a single program bind.
+  void beginUniformsBatch()
+    {jassert(!uniformsBatch); uniformsBatch = true;}
+
+  GLErrorFlags endUniformsBatch()
+  {
+    jassert(uniformsBatch);
+    uniformsBatch = false;
+    return flushUniforms();
+  }
+
+  GLErrorFlags flushUniforms()
+  {
+    if (dirtyUniforms.empty())
+      return GLErrorFlags::succeed;
+    if (!id)
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
+
+    GLScopedSetValue<GLenum> _(context.getActiveProgramBind(), id);
+    for (size_t i = 0; i < dirtyUniforms.size(); ++i)
+    {
+      GLUniformShadow& shadow = uniformShadows[dirtyUniforms[i]];
+      jassert(shadow.dirty && shadow.send);
+      shadow.send(dirtyUniforms[i], shadow.count, shadow.transpose, &shadow.value[0]);
+      shadow.dirty = false;
+    }
+    dirtyUniforms.clear();
+    jassertglsucceed(context);
+    return GLErrorFlags::succeed;
+  }
+
+  // to call if uniforms were modified without using this object.
+  void invalidateUniforms()
+    {uniformShadows.clear(); dirtyUniforms.clear();}
 
   // properties Warning: possible OpenGL flush performance penalty.
   template<typename GLType>
@@ -3117,9 +7201,9 @@ public:
       {jassertfalse; return GLErrorFlags::invalidValueFlag;}
 
     jassert(isValid());
-    context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(context, resourceErrorCheck);
     glGetProgramInfoLog(id, maxLength, length, infoLog);
-    const GLErrorFlags errorFlags = context.popErrorFlags();
+    const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, resourceErrorCheck);
     jassert(errorFlags.hasSucceed());
     return errorFlags;
   }
@@ -3138,9 +7222,11 @@ public:
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
     if (!isValidVariableName(name))
       {jassertfalse; return GLErrorFlags::invalidValueFlag;}
-    context.clearErrorFlags();
+    if (isReflected(name))
+      return findReflectedLocation(GLProgramVariable::attributeKind, 0, name, location);
+    DOCGL_CLEAR_ERROR_FLAGS(context, resourceErrorCheck);
     location = glGetAttribLocation(id, name);
-    const GLErrorFlags errorFlags = context.popErrorFlags();
+    const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, resourceErrorCheck);
     if (errorFlags.hasErrors())
       {jassertfalse; return errorFlags;}
     if (location == -1)
@@ -3155,9 +7241,11 @@ public:
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
     if (!isValidVariableName(name))
       {jassertfalse; return GLErrorFlags::invalidValueFlag;}
-    context.clearErrorFlags();
+    if (isReflected(name))
+      return findReflectedLocation(GLProgramVariable::uniformKind, 0, name, location);
+    DOCGL_CLEAR_ERROR_FLAGS(context, resourceErrorCheck);
     location = glGetUniformLocation(id, name);
-    const GLErrorFlags errorFlags = context.popErrorFlags();
+    const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, resourceErrorCheck);
     if (errorFlags.hasErrors())
       {jassertfalse; return errorFlags;}
     if (location == -1)
@@ -3165,23 +7253,49 @@ public:
     return errorFlags;
   }
 
+  // for uniform blocks
+  GLErrorFlags getUniformBlockIndex(const GLchar* name, GLuint& index)
+  {
+    if (!isValid())
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
+    if (!isValidVariableName(name))
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    if (isReflected(name))
+    {
+      GLint location;
+      const GLErrorFlags errorFlags = findReflectedLocation(GLProgramVariable::uniformBlockKind, 0, name, location);
+      index = errorFlags.hasSucceed() ? static_cast<GLuint>(location) : GL_INVALID_INDEX;
+      return errorFlags;
+    }
+    DOCGL_CLEAR_ERROR_FLAGS(context, resourceErrorCheck);
+    index = glGetUniformBlockIndex(id, name);
+    const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, resourceErrorCheck);
+    if (errorFlags.hasErrors())
+      {jassertfalse; return errorFlags;}
+    if (index == GL_INVALID_INDEX)
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    return errorFlags;
+  }
+
   // for subroutines
   GLErrorFlags getSubroutineUniformLocation(GLenum shaderType, const GLchar* name, GLint& location)
   {
-    if (!GLEW_ARB_shader_subroutine)
+    if (!context.hasCapability(shaderSubroutineCapability))
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // // this is not an OpenGL3.3 feature (ARB extension included in OpenGL 4.1)
     if (!isValid())
       {jassertfalse; return GLErrorFlags::invalidValueFlag;}
     if (!context.isValidShaderType(shaderType))
       {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+    if (isReflected(name))
+      return findReflectedLocation(GLProgramVariable::subroutineUniformKind, shaderType, name, location);
+    DOCGL_CLEAR_ERROR_FLAGS(context, resourceErrorCheck);
     location = glGetSubroutineUniformLocation(id, shaderType, name);
-    const GLErrorFlags errorFlags = context.popErrorFlags();
+    const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, resourceErrorCheck);
     if (errorFlags.hasErrors())
       {jassertfalse; return errorFlags;}
     if (location == -1)
       {jassertfalse; return GLErrorFlags::invalidValueFlag;} // compiler can remove unused uniform.
     return errorFlags;
-    context.clearErrorFlags();
   }
 
   GLErrorFlags getActiveSubRoutines(GLenum shaderType, GLint& value) const;
@@ -3192,30 +7306,283 @@ public:
 
   GLErrorFlags getSubroutineIndex(GLenum shaderType, const GLchar* name, GLuint& index)
   {
-    if (!GLEW_ARB_shader_subroutine)
+    if (!context.hasCapability(shaderSubroutineCapability))
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // // this is not an OpenGL3.3 feature (ARB extension included in OpenGL 4.1)
     if (!isValid())
       {jassertfalse; return GLErrorFlags::invalidValueFlag;}
     if (!context.isValidShaderType(shaderType))
       {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
+    if (isReflected(name))
+    {
+      GLint location;
+      const GLErrorFlags errorFlags = findReflectedLocation(GLProgramVariable::subroutineKind, shaderType, name, location);
+      index = errorFlags.hasSucceed() ? static_cast<GLuint>(location) : GL_INVALID_INDEX;
+      return errorFlags;
+    }
+    DOCGL_CLEAR_ERROR_FLAGS(context, resourceErrorCheck);
     index = glGetSubroutineIndex(id, shaderType, name);
-    const GLErrorFlags errorFlags = context.popErrorFlags();
+    const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, resourceErrorCheck);
     if (errorFlags.hasErrors())
       {jassertfalse; return errorFlags;}
     if (index == GL_INVALID_INDEX)
       {jassertfalse; return GLErrorFlags::invalidValueFlag;}
     return errorFlags;
-    context.clearErrorFlags();
   }
 
-  // todo glGetActiveSubroutineUniformiv glGetActiveSubroutineUniformName glGetActiveSubroutineName
+  // active variables enumerated at link time (empty if link failed)
+  const GLProgramReflection& getReflection() const
+    {return reflection;}
 
 protected:
   // GLObject interface
   virtual GLboolean isValidName(GLuint id) const
     {return glIsProgram(id);}
   virtual void deleteNames(GLuint id) const
-    {glDeleteProgram(id);}
+    {context.notifyProgramDeletion(id); glDeleteProgram(id);}
+
+private:
+  std::vector<GLUniformShadow> uniformShadows; // indexed by location, maxShadowedUniformLocation + 1 at most
+  std::vector<GLint> dirtyUniforms;
+  bool uniformsBatch;
+  GLint maxShadowedUniformLocation; // last element location of the reflected uniforms, -1 if not linked
+  GLProgramReflection reflection;
+
+  void forgetLinkedState()
+  {
+    invalidateUniforms();
+    maxShadowedUniformLocation = -1;
+    reflection.clear();
+  }
+
+  // array elements others than the first one are not in the reflection table.
+  bool isReflected(const GLchar* name) const
+    {return reflection.isBuilt() && !strchr(name, '[');}
+
+  GLErrorFlags findReflectedLocation(GLenum kind, GLenum shaderType, const GLchar* name, GLint& location) const
+  {
+    const GLProgramVariable* variable = reflection.find(kind, shaderType, name);
+    location = variable ? variable->location : -1;
+    if (location == -1)
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;} // compiler can remove unused variable.
+    return GLErrorFlags::succeed;
+  }
+
+  GLErrorFlags buildReflection()
+  {
+    reflection.clear();
+    maxShadowedUniformLocation = -1;
+    DOCGL_CLEAR_ERROR_FLAGS(context, resourceErrorCheck);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(id, GL_LINK_STATUS, &linked);
+    if (!linked)
+      return DOCGL_POP_ERROR_FLAGS(context, resourceErrorCheck); // nothing to reflect
+
+    GLint numVariables = 0;
+    GLint maxLength = 0;
+    std::vector<GLchar> name;
+
+    // uniforms
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &numVariables);
+    glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    if (numVariables > 0)
+    {
+      name.resize(maxLength + 1);
+      std::vector<GLuint> indices(numVariables);
+      std::vector<GLint> offsets(numVariables, -1);
+      std::vector<GLint> blockIndices(numVariables, -1);
+      for (GLint i = 0; i < numVariables; ++i)
+        indices[i] = i;
+      glGetActiveUniformsiv(id, numVariables, &indices[0], GL_UNIFORM_OFFSET, &offsets[0]);
+      glGetActiveUniformsiv(id, numVariables, &indices[0], GL_UNIFORM_BLOCK_INDEX, &blockIndices[0]);
+      for (GLint i = 0; i < numVariables; ++i)
+      {
+        GLint size = 0;
+        GLenum type = 0;
+        name[0] = 0;
+        glGetActiveUniform(id, i, static_cast<GLsizei>(name.size()), NULL, &size, &type, &name[0]);
+        const GLint location = blockIndices[i] < 0 ? glGetUniformLocation(id, &name[0]) : -1;
+        if (location >= 0)
+          maxShadowedUniformLocation = std::max(maxShadowedUniformLocation, location + std::max(size, 1) - 1);
+        reflection.add(GLProgramVariable::uniformKind, 0, &name[0], location, type, size, offsets[i], blockIndices[i]);
+      }
+    }
+
+    // attributes
+    glGetProgramiv(id, GL_ACTIVE_ATTRIBUTES, &numVariables);
+    glGetProgramiv(id, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+    name.resize(maxLength + 1);
+    for (GLint i = 0; i < numVariables; ++i)
+    {
+      GLint size = 0;
+      GLenum type = 0;
+      name[0] = 0;
+      glGetActiveAttrib(id, i, static_cast<GLsizei>(name.size()), NULL, &size, &type, &name[0]);
+      reflection.add(GLProgramVariable::attributeKind, 0, &name[0], glGetAttribLocation(id, &name[0]), type, size, -1, -1);
+    }
+
+    // uniform blocks
+    glGetProgramiv(id, GL_ACTIVE_UNIFORM_BLOCKS, &numVariables);
+    glGetProgramiv(id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+    name.resize(maxLength + 1);
+    for (GLint i = 0; i < numVariables; ++i)
+    {
+      GLint dataSize = 0;
+      name[0] = 0;
+      glGetActiveUniformBlockName(id, i, static_cast<GLsizei>(name.size()), NULL, &name[0]);
+      glGetActiveUniformBlockiv(id, i, GL_UNIFORM_BLOCK_DATA_SIZE, &dataSize);
+      reflection.add(GLProgramVariable::uniformBlockKind, 0, &name[0], i, 0, dataSize, -1, -1);
+    }
+
+    // subroutines
+    if (context.hasCapability(shaderSubroutineCapability))
+    {
+      static const GLenum shaderTypes[] = {GL_VERTEX_SHADER, GL_TESS_CONTROL_SHADER, GL_TESS_EVALUATION_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER};
+      for (size_t stage = 0; stage < sizeof(shaderTypes) / sizeof(shaderTypes[0]); ++stage)
+      {
+        const GLenum shaderType = shaderTypes[stage];
+        glGetProgramStageiv(id, shaderType, GL_ACTIVE_SUBROUTINES, &numVariables);
+        glGetProgramStageiv(id, shaderType, GL_ACTIVE_SUBROUTINE_MAX_LENGTH, &maxLength);
+        name.resize(maxLength + 1);
+        for (GLint i = 0; i < numVariables; ++i)
+        {
+          name[0] = 0;
+          glGetActiveSubroutineName(id, shaderType, i, static_cast<GLsizei>(name.size()), NULL, &name[0]);
+          reflection.add(GLProgramVariable::subroutineKind, shaderType, &name[0], i, 0, 1, -1, -1);
+        }
+
+        glGetProgramStageiv(id, shaderType, GL_ACTIVE_SUBROUTINE_UNIFORMS, &numVariables);
+        glGetProgramStageiv(id, shaderType, GL_ACTIVE_SUBROUTINE_UNIFORM_MAX_LENGTH, &maxLength);
+        name.resize(maxLength + 1);
+        for (GLint i = 0; i < numVariables; ++i)
+        {
+          GLint size = 0;
+          name[0] = 0;
+          glGetActiveSubroutineUniformName(id, shaderType, i, static_cast<GLsizei>(name.size()), NULL, &name[0]);
+          glGetActiveSubroutineUniformiv(id, shaderType, i, GL_UNIFORM_SIZE, &size);
+          reflection.add(GLProgramVariable::subroutineUniformKind, shaderType, &name[0], glGetSubroutineUniformLocation(id, shaderType, &name[0]), 0, size, -1, -1);
+        }
+      }
+    }
+
+    const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, resourceErrorCheck);
+    if (errorFlags.hasErrors())
+      {jassertfalse; reflection.clear(); maxShadowedUniformLocation = -1; return errorFlags;}
+    reflection.build();
+    context.notifyProgramLink(id);
+    return errorFlags;
+  }
+
+  static GLenum getUniformComponentType(const GLfloat*)
+    {return GL_FLOAT;}
+  static GLenum getUniformComponentType(const GLint*)
+    {return GL_INT;}
+  static GLenum getUniformComponentType(const GLuint*)
+    {return GL_UNSIGNED_INT;}
+
+  static bool isCompatibleUniformType(GLenum variableType, GLenum componentType, GLint size)
+  {
+    switch (variableType)
+    {
+    case GL_FLOAT:             return componentType == GL_FLOAT && size == 1;
+    case GL_FLOAT_VEC2:        return componentType == GL_FLOAT && size == 2;
+    case GL_FLOAT_VEC3:        return componentType == GL_FLOAT && size == 3;
+    case GL_FLOAT_VEC4:        return componentType == GL_FLOAT && size == 4;
+    case GL_INT:               return componentType == GL_INT && size == 1;
+    case GL_INT_VEC2:          return componentType == GL_INT && size == 2;
+    case GL_INT_VEC3:          return componentType == GL_INT && size == 3;
+    case GL_INT_VEC4:          return componentType == GL_INT && size == 4;
+    case GL_UNSIGNED_INT:      return componentType == GL_UNSIGNED_INT && size == 1;
+    case GL_UNSIGNED_INT_VEC2: return componentType == GL_UNSIGNED_INT && size == 2;
+    case GL_UNSIGNED_INT_VEC3: return componentType == GL_UNSIGNED_INT && size == 3;
+    case GL_UNSIGNED_INT_VEC4: return componentType == GL_UNSIGNED_INT && size == 4;
+    case GL_BOOL:              return size == 1; // booleans accept any component type
+    case GL_BOOL_VEC2:         return size == 2;
+    case GL_BOOL_VEC3:         return size == 3;
+    case GL_BOOL_VEC4:         return size == 4;
+    case GL_FLOAT_MAT2: case GL_FLOAT_MAT3: case GL_FLOAT_MAT4:
+    case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT3x2:
+    case GL_FLOAT_MAT3x4: case GL_FLOAT_MAT4x2: case GL_FLOAT_MAT4x3:
+      return false; // use setUniformMatrix
+    case GL_DOUBLE: case GL_DOUBLE_VEC2: case GL_DOUBLE_VEC3: case GL_DOUBLE_VEC4:
+    case GL_DOUBLE_MAT2: case GL_DOUBLE_MAT3: case GL_DOUBLE_MAT4:
+    case GL_DOUBLE_MAT2x3: case GL_DOUBLE_MAT2x4: case GL_DOUBLE_MAT3x2:
+    case GL_DOUBLE_MAT3x4: case GL_DOUBLE_MAT4x2: case GL_DOUBLE_MAT4x3:
+      return false; // not supported
+    case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_CUBE_SHADOW:
+    case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_1D_ARRAY_SHADOW: case GL_SAMPLER_2D_ARRAY_SHADOW:
+    case GL_SAMPLER_2D_MULTISAMPLE: case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+    case GL_SAMPLER_2D_RECT: case GL_SAMPLER_2D_RECT_SHADOW: case GL_SAMPLER_BUFFER:
+    case GL_SAMPLER_CUBE_MAP_ARRAY: case GL_SAMPLER_CUBE_MAP_ARRAY_SHADOW:
+    case GL_INT_SAMPLER_1D: case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_CUBE:
+    case GL_INT_SAMPLER_1D_ARRAY: case GL_INT_SAMPLER_2D_ARRAY:
+    case GL_INT_SAMPLER_2D_MULTISAMPLE: case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+    case GL_INT_SAMPLER_2D_RECT: case GL_INT_SAMPLER_BUFFER: case GL_INT_SAMPLER_CUBE_MAP_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_1D: case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D: case GL_UNSIGNED_INT_SAMPLER_CUBE:
+    case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE: case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_2D_RECT: case GL_UNSIGNED_INT_SAMPLER_BUFFER: case GL_UNSIGNED_INT_SAMPLER_CUBE_MAP_ARRAY:
+      return componentType == GL_INT && size == 1; // texture unit index
+    default:
+      return false; // unknown type
+    }
+  }
+
+  static GLenum getUniformMatrixType(GLint numRows, GLint numColumns)
+  {
+    switch (numRows * 10 + numColumns)
+    {
+    case 22: return GL_FLOAT_MAT2;
+    case 33: return GL_FLOAT_MAT3;
+    case 44: return GL_FLOAT_MAT4;
+    case 23: return GL_FLOAT_MAT2x3;
+    case 32: return GL_FLOAT_MAT3x2;
+    case 24: return GL_FLOAT_MAT2x4;
+    case 42: return GL_FLOAT_MAT4x2;
+    case 34: return GL_FLOAT_MAT3x4;
+    case 43: return GL_FLOAT_MAT4x3;
+    default: jassertfalse; return 0;
+    }
+  }
+
+  GLErrorFlags setShadowedUniform(GLint location, GLsizei count, GLboolean transpose, const void* value, size_t numBytes, GLUniformShadow::SendFunction send)
+  {
+    if (location < 0)
+      {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
+    if (!id || count < 0 || !value)
+      {jassertfalse; return GLErrorFlags::invalidValueFlag;}
+    if (!count)
+      return GLErrorFlags::succeed;
+
+    if (location > maxShadowedUniformLocation) // not reflected: sent without shadow
+    {
+      GLScopedSetValue<GLenum> _(context.getActiveProgramBind(), id);
+      send(location, count, transpose, value);
+      jassertglsucceed(context);
+      return GLErrorFlags::succeed;
+    }
+    if (static_cast<size_t>(location) >= uniformShadows.size())
+      uniformShadows.resize(location + 1);
+    GLUniformShadow& shadow = uniformShadows[location];
+    if (shadow.isSame(send, count, transpose, value, numBytes))
+      return GLErrorFlags::succeed; // unchanged: skip upload
+
+    shadow.send = send;
+    shadow.count = count;
+    shadow.transpose = transpose;
+    shadow.value.assign(static_cast<const GLubyte*>(value), static_cast<const GLubyte*>(value) + numBytes);
+    if (uniformsBatch)
+    {
+      if (!shadow.dirty)
+        {shadow.dirty = true; dirtyUniforms.push_back(location);}
+      return GLErrorFlags::succeed;
+    }
+
+    GLScopedSetValue<GLenum> _(context.getActiveProgramBind(), id);
+    send(location, count, transpose, value);
+    jassertglsucceed(context);
+    return GLErrorFlags::succeed;
+  }
 };
 
 template <class GLType, GLenum propertyName>
@@ -3230,9 +7597,9 @@ public:
   virtual GLErrorFlags getValue(GLType& param) const
   {
     GLint intValue = 0;
-    GLProperty<GLType>::context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(GLProperty<GLType>::context, resourceErrorCheck);
     glGetProgramiv(programObject.getId(), propertyName, &intValue);
-    GLErrorFlags errorFlags = GLProperty<GLType>::context.popErrorFlags();
+    GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(GLProperty<GLType>::context, resourceErrorCheck);
     if (errorFlags.hasSucceed())
     {
       if (intValue < 0)
@@ -3290,12 +7657,12 @@ public:
   // Warning: possible OpenGL flush performance penalty.
   virtual GLErrorFlags getValue(GLType& param) const
   {
-    if (!GLEW_ARB_shader_subroutine)
+    if (!GLProperty<GLType>::context.hasCapability(shaderSubroutineCapability))
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // // this is not an OpenGL3.3 feature (ARB extension included in OpenGL 4.1)
     GLint intValue = 0;
-    GLProperty<GLType>::context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(GLProperty<GLType>::context, resourceErrorCheck);
     glGetProgramStageiv(programObject.getId(), shaderType, propertyName, &intValue);
-    const GLErrorFlags errorFlags = GLProperty<GLType>::context.popErrorFlags();
+    const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(GLProperty<GLType>::context, resourceErrorCheck);
     jassert(errorFlags.hasSucceed());
     param = static_cast<GLType>(intValue);
     return errorFlags;
@@ -3331,9 +7698,9 @@ public:
   virtual GLErrorFlags getValue(GLType& param) const
   {
     GLint intValue = 0;
-    GLRegister<GLType>::context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(GLRegister<GLType>::context, resourceErrorCheck);
     glGetProgramiv(programObject.getId(), parameterName, &intValue);
-    GLErrorFlags errorFlags = GLRegister<GLType>::context.popErrorFlags();
+    GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(GLRegister<GLType>::context, resourceErrorCheck);
     if (errorFlags.hasSucceed())
     {
       if (intValue < 0)
@@ -3347,7 +7714,7 @@ public:
 
   virtual GLErrorFlags setValue(const GLType& param)
   {
-    if (!GLEW_ARB_separate_shader_objects)
+    if (!GLRegister<GLType>::context.hasCapability(separateShaderObjectsCapability))
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;} // // this is not an OpenGL3.3 feature (ARB extension included in OpenGL 4.1)
     if (param < 0)
 		  return GLErrorFlags::invalidValueFlag;
@@ -3395,7 +7762,22 @@ public:
       {jassertfalse; return GLErrorFlags::invalidValueFlag;}
 
     GLScopedSetValue<GLenum> _(GLRegister<GLProgramUniformRegisterType>::context.getActiveProgramBind(), program);
+    sendValue(location, count, GL_FALSE, param);
+    jassertglsucceed(GLRegister<GLProgramUniformRegisterType>::context);
+    return GLErrorFlags::succeed;
+  }
+
+  // Warning: possible OpenGL flush performance penalty.
+  virtual GLErrorFlags getValue(GLType& param) const
+  {
+    jassertfalse; // not yet implemented TODO
+    return GLErrorFlags::invalidEnumFlag;
+  }
 
+  // send value to the currently bound program (used by GLProgramObject uniforms shadow).
+  static void sendValue(GLint location, GLsizei count, GLboolean /*transpose*/, const void* value)
+  {
+    const GLType param = (GLType)value;
     switch (size)
     {
     case 1: setUniform1d(location, count, param); break;
@@ -3405,44 +7787,34 @@ public:
     default:
       jassertfalse; // unknow uniform size type
     }
-
-    jassertglsucceed(GLRegister<GLProgramUniformRegisterType>::context);
-    return GLErrorFlags::succeed;
-  }
-
-  // Warning: possible OpenGL flush performance penalty.
-  virtual GLErrorFlags getValue(GLType& param) const
-  {
-    jassertfalse; // not yet implemented TODO
-    return GLErrorFlags::invalidEnumFlag;
   }
 
 private:
-  void setUniform1d(GLint location, GLsizei count, const GLfloat* value)
+  static void setUniform1d(GLint location, GLsizei count, const GLfloat* value)
     {glUniform1fv(location, count, value);}
-  void setUniform2d(GLint location, GLsizei count, const GLfloat* value)
+  static void setUniform2d(GLint location, GLsizei count, const GLfloat* value)
     {glUniform2fv(location, count, value);}
-  void setUniform3d(GLint location, GLsizei count, const GLfloat* value)
+  static void setUniform3d(GLint location, GLsizei count, const GLfloat* value)
     {glUniform3fv(location, count, value);}
-  void setUniform4d(GLint location, GLsizei count, const GLfloat* value)
+  static void setUniform4d(GLint location, GLsizei count, const GLfloat* value)
     {glUniform4fv(location, count, value);}
 
-  void setUniform1d(GLint location, GLsizei count, const GLint* value)
+  static void setUniform1d(GLint location, GLsizei count, const GLint* value)
     {glUniform1iv(location, count, value);}
-  void setUniform2d(GLint location, GLsizei count, const GLint* value)
+  static void setUniform2d(GLint location, GLsizei count, const GLint* value)
     {glUniform2iv(location, count, value);}
-  void setUniform3d(GLint location, GLsizei count, const GLint* value)
+  static void setUniform3d(GLint location, GLsizei count, const GLint* value)
     {glUniform3iv(location, count, value);}
-  void setUniform4d(GLint location, GLsizei count, const GLint* value)
+  static void setUniform4d(GLint location, GLsizei count, const GLint* value)
     {glUniform4iv(location, count, value);}
 
-  void setUniform1d(GLint location, GLsizei count, const GLuint* value)
+  static void setUniform1d(GLint location, GLsizei count, const GLuint* value)
     {glUniform1uiv(location, count, value);}
-  void setUniform2d(GLint location, GLsizei count, const GLuint* value)
+  static void setUniform2d(GLint location, GLsizei count, const GLuint* value)
     {glUniform2uiv(location, count, value);}
-  void setUniform3d(GLint location, GLsizei count, const GLuint* value)
+  static void setUniform3d(GLint location, GLsizei count, const GLuint* value)
     {glUniform3uiv(location, count, value);}
-  void setUniform4d(GLint location, GLsizei count, const GLuint* value)
+  static void setUniform4d(GLint location, GLsizei count, const GLuint* value)
     {glUniform4uiv(location, count, value);}
 
 private:
@@ -3463,17 +7835,22 @@ public:
     , programObject(programObject), location(location), count(count), transpose(transpose)
     {jassert(programObject.isValid());}
 
+  static bool isValidSize()
+  {
+    return (numRows == 2 && numColumns == 2) ||
+           (numRows == 3 && numColumns == 3) ||
+           (numRows == 4 && numColumns == 4) ||
+           (numRows == 2 && numColumns == 3) ||
+           (numRows == 3 && numColumns == 2) ||
+           (numRows == 2 && numColumns == 4) ||
+           (numRows == 4 && numColumns == 2) ||
+           (numRows == 3 && numColumns == 4) ||
+           (numRows == 4 && numColumns == 3);
+  }
+
   virtual GLErrorFlags setValue(const GLType& param)
   {
-    if (!(numRows == 2 && numColumns == 2) &&
-        !(numRows == 3 && numColumns == 3) &&
-        !(numRows == 4 && numColumns == 4) &&
-        !(numRows == 2 && numColumns == 3) &&
-        !(numRows == 3 && numColumns == 2) &&
-        !(numRows == 2 && numColumns == 4) &&
-        !(numRows == 4 && numColumns == 2) &&
-        !(numRows == 3 && numColumns == 4) &&
-        !(numRows == 4 && numColumns == 3))
+    if (!isValidSize())
       {jassertfalse; return GLErrorFlags::invalidEnumFlag;}
     if (location == -1)
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
@@ -3482,7 +7859,22 @@ public:
       {jassertfalse; return GLErrorFlags::invalidValueFlag;}
 
     GLScopedSetValue<GLenum> _(context.getActiveProgramBind(), program);
+    sendValue(location, count, transpose, param);
+    jassertglsucceed(context);
+    return GLErrorFlags::succeed;
+  }
+
+  // Warning: possible OpenGL flush performance penalty.
+  virtual GLErrorFlags getValue(GLType& param) const
+  {
+    jassertfalse; // not yet implemented TODO
+    return GLErrorFlags::invalidEnumFlag;
+  }
 
+  // send value to the currently bound program (used by GLProgramObject uniforms shadow).
+  static void sendValue(GLint location, GLsizei count, GLboolean transpose, const void* value)
+  {
+    const GLfloat* param = static_cast<const GLfloat*>(value);
     if (numRows == 2 && numColumns == 2)
       glUniformMatrix2fv(location, count, transpose, param);
     else if (numRows == 3 && numColumns == 3)
@@ -3503,16 +7895,6 @@ public:
       glUniformMatrix4x3fv(location, count, transpose, param);
     else
       {jassertfalse;}  // unknow uniform size type
-
-    jassertglsucceed(context);
-    return GLErrorFlags::succeed;
-  }
-
-  // Warning: possible OpenGL flush performance penalty.
-  virtual GLErrorFlags getValue(GLType& param) const
-  {
-    jassertfalse; // not yet implemented TODO
-    return GLErrorFlags::invalidEnumFlag;
   }
 
 private:
@@ -3536,7 +7918,7 @@ public:
 
   GLErrorFlags create()
   {
-    if (!GLEW_ARB_separate_shader_objects) // this is not an OpenGL3.3 feature (ARB extension included in OpenGL 4.1)
+    if (!context.hasCapability(separateShaderObjectsCapability)) // this is not an OpenGL3.3 feature (ARB extension included in OpenGL 4.1)
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
     jassert(!id); // overwritting existing: potential memory leak
     // optimizing: here we no not need to access to OpenGL errorFlags.
@@ -3549,7 +7931,7 @@ public:
 
   GLErrorFlags linkToProgram(GLbitfield stages, GLuint program)
   {
-    if (!GLEW_ARB_separate_shader_objects) // this is not an OpenGL3.3 feature (ARB extension included in OpenGL 4.1)
+    if (!context.hasCapability(separateShaderObjectsCapability)) // this is not an OpenGL3.3 feature (ARB extension included in OpenGL 4.1)
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
     if (!isValidStagesBitField(stages))
       {jassertfalse; return GLErrorFlags::invalidValueFlag;}
@@ -3586,9 +7968,9 @@ public:
       {jassertfalse; return GLErrorFlags::invalidValueFlag;}
 
     jassert(isValid());
-    context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(context, resourceErrorCheck);
     glGetProgramPipelineInfoLog(id, maxLength, length, infoLog);
-    const GLErrorFlags errorFlags = context.popErrorFlags();
+    const GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, resourceErrorCheck);
     jassert(errorFlags.hasSucceed());
     return errorFlags;
   }
@@ -3620,9 +8002,9 @@ public:
 protected:
   // GLObject interface
   virtual GLboolean isValidName(GLuint id) const
-    {return GLEW_ARB_separate_shader_objects ? glIsProgramPipeline(id) : false;}
+    {return context.hasCapability(separateShaderObjectsCapability) ? glIsProgramPipeline(id) : false;}
   virtual void deleteNames(GLuint id) const
-    {if (GLEW_ARB_separate_shader_objects) glDeleteProgramPipelines(1, &id);}
+    {if (context.hasCapability(separateShaderObjectsCapability)) {context.notifyProgramPipelineDeletion(id); glDeleteProgramPipelines(1, &id);}}
 };
 
 template <class GLProgramPipelinePropertyType, GLenum propertyName, GLint defaultValue = 0>
@@ -3641,15 +8023,15 @@ public:
   // Warning: possible OpenGL flush performance penalty.
   virtual GLErrorFlags getValue(GLType& param) const
   {
-    if (!GLEW_ARB_separate_shader_objects)
+    if (!GLProperty<GLProgramPipelinePropertyType>::context.hasCapability(separateShaderObjectsCapability))
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
     if (!pipelineObject.getId())
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
     jassert(pipelineObject.isValid());
-    GLProperty<GLProgramPipelinePropertyType>::context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(GLProperty<GLProgramPipelinePropertyType>::context, resourceErrorCheck);
     GLint intValue = defaultValue;
     glGetProgramPipelineiv(pipelineObject.getId(), GL_ACTIVE_PROGRAM, &intValue);
-    GLErrorFlags errorFlags = GLProperty<GLProgramPipelinePropertyType>::context.popErrorFlags();
+    GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(GLProperty<GLProgramPipelinePropertyType>::context, resourceErrorCheck);
     if (errorFlags.hasSucceed())
     {
       if (intValue < 0)
@@ -3682,15 +8064,15 @@ public:
   // Warning: possible OpenGL flush performance penalty.
   virtual GLErrorFlags getValue(GLuint& program) const
   {
-    if (!GLEW_ARB_separate_shader_objects)
+    if (!context.hasCapability(separateShaderObjectsCapability))
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
     if (!pipelineObject.getId())
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
     jassert(pipelineObject.isValid());
-    context.clearErrorFlags();
+    DOCGL_CLEAR_ERROR_FLAGS(context, stateErrorCheck);
     GLint intValue = 0; // TODO check specification
     glGetProgramPipelineiv(pipelineObject.getId(), GL_ACTIVE_PROGRAM, &intValue);
-    GLErrorFlags errorFlags = context.popErrorFlags();
+    GLErrorFlags errorFlags = DOCGL_POP_ERROR_FLAGS(context, stateErrorCheck);
     if (errorFlags.hasSucceed())
     {
       if (intValue < 0)
@@ -3706,7 +8088,7 @@ public:
 
   virtual GLErrorFlags setValue(const GLuint& program)
   {
-    if (!GLEW_ARB_separate_shader_objects)
+    if (!context.hasCapability(separateShaderObjectsCapability))
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;}
     if (!pipelineObject.getId() || !program)
       {jassertfalse; return GLErrorFlags::invalidOperationFlag;}